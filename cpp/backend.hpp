@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+/**
+ * Solver interface beneath `graph` and `subtour_elim`.
+ *
+ * Models are built from binary variables and linear rows, and solved with a single callback that
+ * may add lazy constraints and user cuts or propose solutions. Variables are plain column numbers,
+ * so expressions can be built on any thread and only reach the solver when they are submitted.
+ */
+namespace backend {
+    /** Position of a variable in its model, in creation order. */
+    using column = uint32_t;
+
+    enum class sense : char {
+        less_equal = '<',
+        greater_equal = '>',
+        equal = '=',
+    };
+
+    /** How a solve ended. */
+    enum class status : uint8_t {
+        optimal,
+        time_limit,
+        interrupted,
+        infeasible,
+        unknown,
+    };
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    static constexpr std::string_view status_name(status result) noexcept {
+        switch (result) {
+            case status::optimal:
+                return "optimal";
+            case status::time_limit:
+                return "time_limit";
+            case status::interrupted:
+                return "interrupted";
+            case status::infeasible:
+                return "infeasible";
+            default:
+                return "unknown";
+        }
+    }
+
+    /** Model attributes, summed over the models of a graph. */
+    enum class attribute : uint8_t {
+        solutions,
+        nodes,
+        iterations,
+        variables,
+        constraints,
+        quadratic_constraints,
+        objective,
+        bound,
+    };
+
+    /** Point of the solve where the callback runs. */
+    enum class event : uint8_t {
+        /** Periodic progress of the branch and bound. */
+        progress,
+        /** A new integral solution, before it is accepted. */
+        solution,
+        /** A node relaxation, before branching on it. */
+        node,
+        other,
+    };
+
+    /** Values the callback can ask for, as seen at the current event. */
+    enum class info : uint8_t {
+        runtime,
+        nodes,
+        /** Objective of the best incumbent, infinite if there is none. */
+        incumbent,
+        bound,
+        /** Objective of the new integral solution, only at `event::solution`. */
+        objective,
+    };
+
+    static constexpr size_t info_count = size_t(info::objective) + 1;
+
+    /** Sum of `coefficients[j] * columns[j]`. */
+    struct linear_expr final {
+        std::vector<column> columns;
+        std::vector<double> coefficients;
+
+        [[gnu::hot]]
+        inline void add(column var, double coefficient = 1.0) {
+            this->columns.push_back(var);
+            this->coefficients.push_back(coefficient);
+        }
+
+        /** Number of nonzeros. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline size_t size() const noexcept {
+            return this->columns.size();
+        }
+    };
+
+    /**
+     * What a callback can ask and tell the solver.
+     *
+     * Only valid during the call and on the thread the solver made it from.
+     */
+    struct context {
+        virtual ~context() = default;
+
+        virtual event where() const = 0;
+        virtual double get(info what) = 0;
+        /** Whether the node relaxation was solved to optimality, only at `event::node`. */
+        virtual bool relaxation_solved() = 0;
+
+        /** Values of `columns` in the new integral solution, only at `event::solution`. */
+        virtual void solution(std::span<const column> columns, std::span<double> values) = 0;
+        /** Values of `columns` in the node relaxation, only at `event::node`. */
+        virtual void relaxation(std::span<const column> columns, std::span<double> values) = 0;
+
+        virtual void add_lazy(const linear_expr& expr, sense sense, double rhs) = 0;
+        virtual void add_cut(const linear_expr& expr, sense sense, double rhs) = 0;
+        /** Proposes `values` for `columns` as a solution, which the solver checks on its own. */
+        virtual void set_solution(std::span<const column> columns, std::span<const double> values) = 0;
+        /** Stops the solve, keeping its incumbent and bound. */
+        virtual void abort() = 0;
+    };
+
+    /** Code run by the solver at each event of a solve. */
+    struct callback {
+        virtual ~callback() = default;
+
+        virtual void operator()(context& solver) = 0;
+    };
+
+    /** A single optimization model, solved at most once per `optimize`. */
+    struct model {
+        virtual ~model() = default;
+
+        /**
+         * Adds one binary variable per coefficient of `objective`, with the given `names` if any.
+         *
+         * The new columns are consecutive, starting at the returned one.
+         */
+        virtual column add_binaries(std::span<const double> objective, std::span<const std::string> names = {}) = 0;
+        virtual void add_constrs(std::span<const linear_expr> exprs, sense sense, double rhs) = 0;
+        /** Applies pending changes, so that building the model can be timed apart from solving it. */
+        virtual void update() = 0;
+
+        virtual void threads(unsigned count) = 0;
+        virtual void time_limit(double seconds) = 0;
+        /** Values of `columns` in the starting solution. */
+        virtual void start(std::span<const column> columns, std::span<const double> values) = 0;
+
+        virtual void optimize(callback& callback) = 0;
+        virtual status result() const = 0;
+        virtual double get(attribute what) const = 0;
+        /** Values of `columns` in the best solution found, which must exist. */
+        virtual void solution(std::span<const column> columns, std::span<double> values) const = 0;
+    };
+
+    /** Creates models, possibly sharing a licence or a recording between them. */
+    struct environment {
+        virtual ~environment() = default;
+
+        virtual std::unique_ptr<model> make_model() const = 0;
+        /** Environment for a model solved alongside the ones of this, using at most `threads`. */
+        virtual std::unique_ptr<environment> split(unsigned threads) const = 0;
+    };
+}
@@ -0,0 +1,414 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "costs.hpp"
+#include "tour.hpp"
+#include "one_tree.hpp"
+#include "lagrangian.hpp"
+#include "pricing.hpp"
+#include "stop.hpp"
+
+
+struct branch_options final {
+    /** Subgradient method at the root, where the multipliers start from zero. */
+    subgradient_options root = {};
+    /** Subgradient method at every other node, starting from the multipliers of its parent. */
+    subgradient_options node = { .max_iterations = 150, .step = 0.5, .patience = 15, .min_step = 1e-3, .repair_interval = 25 };
+    /** Wall clock limit for the whole search, in seconds. */
+    std::optional<double> time_limit = std::nullopt;
+};
+
+
+/**
+ * Branch and bound on the lagrangian 1-tree bound, without any external solver.
+ *
+ * Each node fixes some edges into or out of a tour and is bounded by the subgradient method under
+ * those fixings, warm started from the multipliers of its parent. Nodes are branched on an edge
+ * at a vertex of degree above two in one of the 1-trees, then on an edge used by a single tree
+ * while they share fewer than `k` edges, and explored best bound first. Every tour pair found by
+ * the lagrangian heuristic or as a pair of 1-trees is a global upper bound. Edges whose reduced
+ * cost at the root already reaches the incumbent are left out of the whole search.
+ *
+ * Without a similarity constraint the problem splits into one TSP per layer, so each layer is then
+ * searched on its own, concurrently, instead of over the product of both trees.
+ */
+struct branch_and_bound final {
+private:
+    struct fixed_edge final {
+        uint8_t tour;
+        unsigned u;
+        unsigned v;
+        bool include;
+    };
+
+    struct node final {
+        /** Bound of the parent, valid until the node itself is bounded. */
+        double bound;
+        std::vector<fixed_edge> fixed;
+        /** Multipliers of the parent, shared by both children. */
+        std::shared_ptr<const lagrangian_multipliers> start;
+    };
+
+    const ::costs& costs;
+    const size_t n;
+    const unsigned k;
+    const branch_options options;
+
+    ::lagrangian relaxation;
+    /** Single layer instances and their searches, when `k` is zero. */
+    utils::pair<std::unique_ptr<const ::costs>> layer_costs;
+    utils::pair<std::unique_ptr<branch_and_bound>> layers;
+    /** Edges that cannot improve on the incumbent by their reduced cost at the root, left out everywhere. */
+    std::vector<fixed_edge> eliminated;
+    std::vector<node> open;
+    uint64_t explored = 0;
+    uint64_t subgradient_iterations = 0;
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool identical() const noexcept {
+        return this->k >= this->n;
+    }
+
+    [[gnu::hot]]
+    inline edge_fixing fixing_of(const node& current) const {
+        auto fixing = edge_fixing(this->n);
+        for (const auto& edge : this->eliminated) {
+            fixing.fix(edge.tour, edge.u, edge.v, edge.include);
+        }
+        for (const auto& edge : current.fixed) {
+            fixing.fix(edge.tour, edge.u, edge.v, edge.include);
+        }
+        return fixing;
+    }
+
+    /** Whether every vertex of `tree` has degree two, making it a Hamiltonian cycle. */
+    [[gnu::pure]] [[gnu::hot]]
+    static bool is_tour(const one_tree& tree) {
+        return std::ranges::all_of(tree.degree, [](int degree) { return degree == 2; });
+    }
+
+    [[gnu::hot]]
+    inline ::tour walk(const one_tree& tree) const {
+        auto adjacency = utils::adjacency(this->n);
+        for (auto [u, v] : tree.edges) {
+            adjacency.add(u, v);
+        }
+        return tour::min_sub_tour(adjacency);
+    }
+
+    /** Edge to branch on for the relaxed solution `trees`, or nothing if every one is fixed. */
+    [[gnu::hot]]
+    inline std::optional<fixed_edge> branching_edge(const utils::pair<one_tree>& trees, const edge_fixing& fixing) const {
+        for (uint8_t i = 0; i <= 1; i++) {
+            const auto& degree = trees[i].degree;
+            const unsigned v = std::ranges::max_element(degree) - degree.begin();
+            if (degree[v] <= 2) [[likely]] {
+                continue;
+            }
+
+            auto best = std::optional<fixed_edge>();
+            int32_t heaviest = std::numeric_limits<int32_t>::min();
+            for (auto [a, b] : trees[i].edges) {
+                if ((a == v || b == v) && fixing.is_free(i, a, b) && this->costs(i, a, b) > heaviest) {
+                    heaviest = this->costs(i, a, b);
+                    best = fixed_edge { i, a, b, true };
+                }
+            }
+            if (best) [[likely]] {
+                return best;
+            }
+        }
+
+        auto in_first = utils::triangular<bool>(this->n);
+        for (auto [u, v] : trees[0].edges) {
+            in_first.set(u, v);
+        }
+        size_t similarity = 0;
+        for (auto [u, v] : trees[1].edges) {
+            similarity += in_first(u, v);
+        }
+        if (similarity < this->k) {
+            auto in_second = utils::triangular<bool>(this->n);
+            for (auto [u, v] : trees[1].edges) {
+                in_second.set(u, v);
+            }
+            for (auto [u, v] : trees[0].edges) {
+                if (fixing.is_free(1, u, v) && !in_second(u, v)) {
+                    return fixed_edge { 1, u, v, true };
+                }
+            }
+        }
+
+        for (uint8_t i = 0; i <= 1; i++) {
+            for (auto [u, v] : trees[i].edges) {
+                if (fixing.is_free(i, u, v)) {
+                    return fixed_edge { i, u, v, true };
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * Bounds `current` and, unless it is pruned, pushes its children.
+     *
+     * Returns false if the time limit or an interrupt stopped the subgradient method first, leaving
+     * the node unexplored with the bound reached so far, which holds for any multipliers.
+     */
+    [[gnu::hot]]
+    inline bool evaluate(node& current) {
+        auto fixing = this->fixing_of(current);
+        this->relaxation.restart(fixing, *current.start, this->explored <= 0 ? this->options.root : this->options.node);
+        this->relaxation.solve();
+        this->subgradient_iterations += this->relaxation.iterations();
+
+        const double bound = std::max(current.bound, this->relaxation.lower_bound());
+        if (this->timed_out() || utils::should_stop()) [[unlikely]] {
+            current.bound = bound;
+            return false;
+        }
+        this->explored += 1;
+        if (bound >= this->upper_bound()) {
+            return true;
+        }
+        if (this->explored <= 1) [[unlikely]] {
+            this->eliminate();
+            fixing = this->fixing_of(current);
+        }
+
+        const auto trees = this->relaxation.best_trees();
+        if (is_tour(trees[0]) && is_tour(trees[1])) {
+            const auto tours = utils::pair<::tour> { this->walk(trees[0]), this->walk(trees[1]) };
+            if (lagrangian_heuristic::similarity(tours[0], tours[1]) >= std::min<size_t>(this->k, this->n)) {
+                this->relaxation.incumbent(tours);
+            }
+        }
+
+        const auto edge = this->branching_edge(trees, fixing);
+        if (!edge || bound >= this->upper_bound()) {
+            return true;
+        }
+
+        const auto start = std::make_shared<const lagrangian_multipliers>(this->relaxation.multipliers());
+        // the child including the edge is pushed last, so it is explored first
+        for (bool include : { false, true }) {
+            auto child = node { bound, current.fixed, start };
+            child.fixed.push_back({ edge->tour, edge->u, edge->v, include });
+            if (this->identical()) [[unlikely]] {
+                child.fixed.push_back({ uint8_t(1 - edge->tour), edge->u, edge->v, include });
+            }
+            this->open.push_back(std::move(child));
+            std::ranges::push_heap(this->open, std::greater(), &node::bound);
+        }
+        return true;
+    }
+
+    /** Leaves out every edge whose reduced cost at the root closes the gap to the incumbent. */
+    [[gnu::cold]]
+    inline void eliminate() {
+        const auto pricing = edge_pricing(this->relaxation, this->k);
+        const auto& best = utils::pair<::tour> { this->tour(0), this->tour(1) };
+        for (uint8_t i = 0; i <= 1; i++) {
+            auto used = utils::triangular<bool>(this->n);
+            for (size_t p = 0; p < best[i].size(); p++) {
+                used.set(best[i][p], best[i][(p + 1) % best[i].size()]);
+            }
+            for (unsigned v = 0; v < this->n; v++) {
+                for (unsigned u = 0; u < v; u++) {
+                    if (!used(u, v) && pricing.bound(i, u, v) >= this->upper_bound()) {
+                        this->eliminated.push_back({ i, u, v, false });
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * Searches both layers concurrently, so that each gets the whole time limit instead of the
+     * first one using it up before the second has bounded its root.
+     */
+    [[gnu::hot]]
+    inline void solve_layers() {
+        auto errors = utils::pair<std::exception_ptr>();
+        auto threads = std::vector<std::thread>();
+
+        for (uint8_t i = 0; i <= 1; i++) {
+            threads.emplace_back([this, i, &errors] {
+                try {
+                    this->layers[i]->solve();
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (const auto& error : errors) {
+            if (error) [[unlikely]] {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+    [[gnu::pure]] [[gnu::hot]]
+    inline bool timed_out() const noexcept {
+        if (auto limit = this->options.time_limit) [[likely]] {
+            return this->elapsed() >= *limit;
+        }
+        return false;
+    }
+
+public:
+    [[gnu::cold]]
+    branch_and_bound(const ::costs& costs, size_t order, unsigned k, branch_options options = {}):
+        costs(costs), n(order), k(k), options(options), relaxation(costs, order, k, options.root)
+    {
+        const auto edges = utils::triangular_size(order);
+        auto zero = std::make_shared<const lagrangian_multipliers>(lagrangian_multipliers {
+            { std::vector<double>(edges, 0.0), std::vector<double>(edges, 0.0) },
+            { std::vector<double>(order, 0.0), std::vector<double>(order, 0.0) },
+        });
+        this->open.push_back({ -std::numeric_limits<double>::infinity(), {}, std::move(zero) });
+
+        if (k <= 0) {
+            for (uint8_t i = 0; i <= 1; i++) {
+                this->layer_costs[i] = std::make_unique<const ::costs>(costs.single(i));
+                this->layers[i] = std::make_unique<branch_and_bound>(*this->layer_costs[i], order, order, options);
+            }
+        }
+    }
+
+    /** Whether each layer is searched on its own. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool separable() const noexcept {
+        return this->layers[0] != nullptr;
+    }
+
+    using clock = std::chrono::high_resolution_clock;
+    const clock::time_point start = clock::now();
+
+    [[gnu::cold]] [[gnu::nothrow]]
+    inline double elapsed() const noexcept {
+        auto end = clock::now();
+        std::chrono::duration<double> secs = end - this->start;
+        return secs.count();
+    }
+
+    /** Number of vertices. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t order() const noexcept {
+        return this->n;
+    }
+
+    /** Explores nodes until none is left open, or the time limit or an interrupt stops it. */
+    [[gnu::hot]]
+    double solve() {
+        if (this->separable()) {
+            this->solve_layers();
+            this->open.clear();
+            return this->elapsed();
+        }
+
+        while (!this->open.empty() && !this->timed_out() && !utils::should_stop()) [[likely]] {
+            std::ranges::pop_heap(this->open, std::greater(), &node::bound);
+            auto current = std::move(this->open.back());
+            this->open.pop_back();
+            if (current.bound >= this->upper_bound()) {
+                continue;
+            }
+
+            if (!this->evaluate(current)) [[unlikely]] {
+                // neither pruned nor branched, so it stays open
+                this->open.push_back(std::move(current));
+                std::ranges::push_heap(this->open, std::greater(), &node::bound);
+            }
+        }
+        return this->elapsed();
+    }
+
+    /** Why the last `solve` stopped. */
+    [[gnu::pure]] [[gnu::cold]]
+    std::string_view status() const {
+        if (this->separable()) {
+            const auto first = this->layers[0]->status();
+            return first == "optimal" ? this->layers[1]->status() : first;
+        } else if (this->open.empty()) {
+            return "optimal";
+        } else if (utils::should_stop()) {
+            return "interrupted";
+        }
+        return "time_limit";
+    }
+
+    /** Nodes bounded so far. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline uint64_t nodes() const noexcept {
+        if (this->separable()) {
+            return this->layers[0]->nodes() + this->layers[1]->nodes();
+        }
+        return this->explored;
+    }
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline uint64_t iterations() const noexcept {
+        if (this->separable()) {
+            return this->layers[0]->iterations() + this->layers[1]->iterations();
+        }
+        return this->subgradient_iterations;
+    }
+
+    /** Least bound among the open nodes, or the upper bound once none is left. */
+    [[gnu::pure]] [[gnu::hot]]
+    double lower_bound() const {
+        if (this->separable()) {
+            // each layer counts its tour twice
+            return (this->layers[0]->lower_bound() + this->layers[1]->lower_bound()) / 2;
+        }
+        double lowest = this->upper_bound();
+        for (const auto& pending : this->open) {
+            lowest = std::min(lowest, pending.bound);
+        }
+        return lowest;
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double upper_bound() const noexcept {
+        if (this->separable()) {
+            return (this->layers[0]->upper_bound() + this->layers[1]->upper_bound()) / 2;
+        }
+        return this->relaxation.upper_bound();
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    double gap() const {
+        return (this->upper_bound() - this->lower_bound()) / this->upper_bound();
+    }
+
+    /** Tours of the best solution found. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline const ::tour& tour(uint8_t i) const noexcept {
+        if (this->separable()) {
+            return this->layers[i]->tour(0);
+        }
+        return this->relaxation.tour(i);
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    int64_t tour_cost(uint8_t i) const {
+        if (this->separable()) {
+            return this->layers[i]->tour_cost(0);
+        }
+        return this->relaxation.tour_cost(i);
+    }
+};
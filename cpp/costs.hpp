@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <utility>
+
+#include "vertex.hpp"
+#include "triangular.hpp"
+
+
+namespace utils {
+    /**
+     * Edge costs for a single layer, stored as a packed triangular matrix.
+     *
+     * The layout is prefix-stable, so the table for the first `n` vertices is a prefix of the
+     * table for any larger instance.
+     */
+    struct cost_table final {
+    private:
+        triangular<int32_t, aligned_allocator<int32_t>> buffer;
+
+    public:
+        [[gnu::cold]]
+        cost_table(std::span<const vertex> vertices, uint8_t layer): buffer(vertices.size()) {
+            for (unsigned v = 0; v < this->size(); v++) {
+                for (unsigned u = 0; u < v; u++) {
+                    const auto cost = vertices[u][layer].cost(vertices[v][layer]);
+                    this->buffer(u, v) = static_cast<int32_t>(cost);
+                }
+            }
+        }
+
+        /** Table for the sum of two layers. */
+        [[gnu::cold]]
+        cost_table(const cost_table& first, const cost_table& second): buffer(std::min(first.size(), second.size())) {
+            for (size_t e = 0; e < this->edges(); e++) {
+                this->buffer[e] = first.buffer[e] + second.buffer[e];
+            }
+        }
+
+        /** Number of vertices. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        constexpr size_t size() const noexcept {
+            return this->buffer.size();
+        }
+
+        /** Number of edges. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        constexpr size_t edges() const noexcept {
+            return this->buffer.total();
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline int32_t operator()(unsigned u, unsigned v) const noexcept {
+            if (u == v) [[unlikely]] {
+                return 0;
+            }
+            return this->buffer(u, v);
+        }
+    };
+}
+
+
+/** Precomputed integer costs for both layers of an instance. */
+struct costs final {
+private:
+    utils::pair<utils::cost_table> layers;
+
+    [[gnu::cold]]
+    explicit costs(utils::pair<utils::cost_table> layers): layers(std::move(layers)) { }
+
+public:
+    [[gnu::cold]]
+    explicit costs(std::span<const vertex> vertices):
+        layers({ utils::cost_table(vertices, 0), utils::cost_table(vertices, 1) })
+    { }
+
+    /** Costs with layer `i` on both layers, where a single tour is optimal for both. */
+    [[gnu::cold]]
+    costs single(uint8_t i) const {
+        return costs({ this->layers[i], this->layers[i] });
+    }
+
+    /** Number of vertices covered by the tables. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t order() const noexcept {
+        return this->layers[0].size();
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline const utils::cost_table& operator[](uint8_t i) const noexcept {
+        return this->layers[i];
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline int32_t operator()(uint8_t i, unsigned u, unsigned v) const noexcept {
+        return this->layers[i](u, v);
+    }
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "triangular.hpp"
+
+
+namespace utils {
+    using edge = std::pair<unsigned, unsigned>;
+
+    /**
+     * Subset of the edges of a complete graph, with a position for each edge in insertion order.
+     *
+     * Membership is a bit per edge and each vertex keeps its incident edges, so scanning the edges
+     * around a vertex costs its degree in the subset instead of the order of the graph.
+     */
+    struct edge_set final {
+    private:
+        triangular<bool> mask;
+        std::vector<edge> list;
+        std::vector<std::vector<unsigned>> incident;
+
+    public:
+        [[gnu::cold]]
+        explicit edge_set(size_t order): mask(order), incident(order) { }
+
+        /** Every edge of the complete graph, in `triangular_index` order. */
+        [[gnu::cold]]
+        static edge_set complete(size_t order) {
+            auto edges = edge_set(order);
+            edges.list.reserve(triangular_size(order));
+            for (unsigned v = 0; v < order; v++) {
+                for (unsigned u = 0; u < v; u++) {
+                    edges.add(u, v);
+                }
+            }
+            return edges;
+        }
+
+        /** Edges present in both sets, in the order of `first`. */
+        [[gnu::cold]]
+        static edge_set intersection(const edge_set& first, const edge_set& second) {
+            auto edges = edge_set(first.order());
+            for (auto [u, v] : first) {
+                if (second.contains(u, v)) {
+                    edges.add(u, v);
+                }
+            }
+            return edges;
+        }
+
+        /** Number of vertices of the complete graph. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline size_t order() const noexcept {
+            return this->incident.size();
+        }
+
+        /** Number of edges in the set. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline size_t size() const noexcept {
+            return this->list.size();
+        }
+
+        /** Whether every edge of the complete graph is present. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline bool is_complete() const noexcept {
+            return this->size() >= this->mask.total();
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline bool contains(unsigned u, unsigned v) const noexcept {
+            return u != v && this->mask(u, v);
+        }
+
+        /** Adds `(u, v)`, returning false if it was already present. */
+        [[gnu::hot]]
+        inline bool add(unsigned u, unsigned v) {
+            if (this->contains(u, v) || u == v) {
+                return false;
+            }
+            this->mask.set(u, v);
+            this->list.emplace_back(std::min(u, v), std::max(u, v));
+            this->incident[u].push_back(v);
+            this->incident[v].push_back(u);
+            return true;
+        }
+
+        /** Vertices adjacent to `u` through the set. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline std::span<const unsigned> neighbours(unsigned u) const noexcept {
+            return this->incident[u];
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline const edge& operator[](size_t position) const noexcept {
+            return this->list[position];
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline std::vector<edge>::const_iterator begin() const noexcept {
+            return this->list.begin();
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline std::vector<edge>::const_iterator end() const noexcept {
+            return this->list.end();
+        }
+    };
+}
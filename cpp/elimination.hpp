@@ -1,85 +1,578 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <chrono>
-#include <concepts>
 #include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <span>
 #include <vector>
 
-#include <gurobi_c++.h>
+#include "backend.hpp"
 #include "vertex.hpp"
+#include "costs.hpp"
 #include "tour.hpp"
+#include "edges.hpp"
+#include "heuristic.hpp"
+#include "mincut.hpp"
+#include "pool.hpp"
+#include "stop.hpp"
+#include "timeline.hpp"
 
 
-namespace utils {
-    template <typename Model>
-    concept model = std::regular_invocable<Model, unsigned, unsigned>
-        && std::same_as<std::invoke_result_t<Model, unsigned, unsigned>, bool>;
+struct subtour_options final {
+    /** Maximum lazy cuts per tour on each integer solution, smallest subtours first. */
+    unsigned max_lazy_cuts = 32;
+    /** Separate fractional subtours while fewer nodes than this were explored, disabled if zero. */
+    double fractional_nodes = 500;
+    /** Seconds between bound samples in the progress timeline, disabled if zero. */
+    double sample_interval = 1.0;
+    /** Nodes between attempts to patch the node relaxation into an incumbent, disabled if zero. */
+    double injection_interval = 50;
+    /** Patch only relaxations with at most this many fractional edges per vertex and tour. */
+    double injection_fractional = 0.1;
+    /** Share of the solve time that patching may take. */
+    double injection_budget = 0.05;
+};
 
-    [[gnu::hot]]
-    static inline matrix<bool> get_solutions(size_t size, model auto&& get_solution) noexcept {
-        matrix<bool> sols(size);
+/** How many subtour constraints were added and how dense they were. */
+struct cut_statistics final {
+    uint64_t lazy = 0;
+    uint64_t user = 0;
+    /** Constraints added as `x(E(S)) <= |S| - 1`, on either side of the cut. */
+    uint64_t packing = 0;
+    /** Constraints added as `x(delta(S)) >= 2`. */
+    uint64_t cutset = 0;
+    uint64_t nonzeros = 0;
+    /** Callback invocations, including the ones that added nothing. */
+    uint64_t calls = 0;
+    /** Patched tours handed to the solver as incumbents. */
+    uint64_t injected = 0;
 
-        for (unsigned u = 0; u < size; u++) {
-            sols[u][u] = false;
-            for (unsigned v = u + 1; v < size; v++) {
-                bool has_edge = get_solution(u, v);
-                sols[u][v] = has_edge;
-                sols[v][u] = has_edge;
-            }
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline uint64_t total() const noexcept {
+        return this->lazy + this->user;
+    }
+
+    /** Average number of nonzeros per constraint. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline double density() const noexcept {
+        if (this->total() <= 0) [[unlikely]] {
+            return 0.0;
         }
-        return sols;
+        return double(this->nonzeros) / double(this->total());
     }
 
-    [[gnu::hot]]
-    static tour min_sub_tour(std::span<const vertex> vertices, model auto&& get_solution) noexcept {
-        const auto solutions = get_solutions(vertices.size(), get_solution);
-        return tour::min_sub_tour(vertices, solutions);
+    [[gnu::cold]] [[gnu::nothrow]]
+    inline cut_statistics& operator+=(const cut_statistics& other) noexcept {
+        this->lazy += other.lazy;
+        this->user += other.user;
+        this->packing += other.packing;
+        this->cutset += other.cutset;
+        this->nonzeros += other.nonzeros;
+        this->calls += other.calls;
+        this->injected += other.injected;
+        return *this;
+    }
+};
+
+/**
+ * Binary variables over the edges of an `utils::edge_set`.
+ *
+ * `columns` follows the order of the set, as needed by the array methods of the backend, and
+ * `positions` finds the place of an edge by its endpoints. Edges outside the set have no variable.
+ */
+struct edge_vars final {
+    utils::edge_set edges;
+    std::vector<backend::column> columns;
+    utils::triangular<uint32_t> positions;
+
+    [[gnu::cold]]
+    inline edge_vars(utils::edge_set edges, std::vector<backend::column> columns):
+        edges(std::move(edges)), columns(std::move(columns)), positions(this->edges.order())
+    {
+        for (size_t e = 0; e < this->size(); e++) {
+            this->positions(this->edges[e].first, this->edges[e].second) = e;
+        }
+    }
+
+    /** Number of variables. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t size() const noexcept {
+        return this->columns.size();
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool contains(unsigned u, unsigned v) const noexcept {
+        return this->edges.contains(u, v);
     }
-}
 
-struct subtour_elim final : public GRBCallback {
+    /** Position of edge `(u, v)` in the set, which must contain it. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t position(unsigned u, unsigned v) const noexcept {
+        return this->positions(u, v);
+    }
+
+    /** Variable of edge `(u, v)`, which must be in the set. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline backend::column operator()(unsigned u, unsigned v) const noexcept {
+        return this->columns[this->position(u, v)];
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline backend::column operator[](size_t position) const noexcept {
+        return this->columns[position];
+    }
+};
+
+/**
+ * Subtour elimination for the tours of one model, as lazy constraints on integral solutions and as
+ * user cuts on the first node relaxations.
+ */
+struct subtour_elim final : public backend::callback {
 public:
     const std::span<const vertex> vertices;
-    const  utils::pair<utils::matrix<GRBVar>>& vars;
+    const ::costs& costs;
+    const utils::pair<edge_vars>& vars;
+    /** Shared edge variables, if the model has them. */
+    const std::optional<edge_vars>& shared;
+    const unsigned k;
+    /** Tours whose subtours are eliminated by this callback. */
+    const std::vector<uint8_t> tours;
+    const subtour_options options;
 
-    [[gnu::cold]] [[gnu::nothrow]]
-    inline subtour_elim(std::span<const vertex> vertices, const utils::pair<utils::matrix<GRBVar>>& vars) noexcept:
-        GRBCallback(), vertices(vertices), vars(vars)
+    [[gnu::cold]]
+    inline subtour_elim(
+        std::span<const vertex> vertices,
+        const ::costs& costs,
+        const utils::pair<edge_vars>& vars,
+        const std::optional<edge_vars>& shared,
+        unsigned k,
+        std::vector<uint8_t> tours = { 0, 1 },
+        subtour_options options = {}
+    ):
+        vertices(vertices), costs(costs), vars(vars), shared(shared), k(k), tours(std::move(tours)), options(options),
+        timeline(options.sample_interval),
+        spaces({ workspace(vertices.size(), vars[0].size()), workspace(vertices.size(), vars[1].size()) }),
+        workers(this->tours.size())
     { }
 
+    cut_statistics statistics;
+    std::optional<double> root_bound = std::nullopt;
+    utils::timeline timeline;
+
 private:
+    struct pending_cut final {
+        backend::linear_expr expr;
+        backend::sense sense;
+        double rhs;
+    };
+
+    /** Scratch space for separating one tour, so that both tours can be separated concurrently. */
+    struct workspace final {
+        /** Values of the columns of the tour, in the order of its variables. */
+        std::vector<double> values;
+        std::vector<bool> inside;
+        std::vector<pending_cut> cuts;
+        /** Sides without vertex `0` of the sets cut so far, so that a set and its complement give one cut. */
+        std::vector<std::vector<bool>> separated;
+        cut_statistics statistics;
+
+        [[gnu::cold]]
+        explicit workspace(size_t order, size_t columns): values(columns, 0.0), inside(order, false) { }
+    };
+
+    utils::pair<workspace> spaces;
+    /** One task per entry of `tours`; only the separation runs there, never the solver calls. */
+    utils::worker_pool workers;
+
+    /** Built on the first patching attempt, since sorting the edges is not free. */
+    std::optional<lagrangian_heuristic> heuristic;
+    double next_injection = 0;
+    double injection_time = 0;
+
+    /** Adjacency of the integral solution in `values`, in the column order of tour `i`. */
+    [[gnu::hot]]
+    inline utils::adjacency solution(uint8_t i, std::span<const double> values) const {
+        auto adjacency = utils::adjacency(this->count());
+        for (size_t e = 0; e < this->vars[i].size(); e++) {
+            if (values[e] > 0.5) {
+                const auto [u, v] = this->vars[i].edges[e];
+                adjacency.add(u, v);
+            }
+        }
+        return adjacency;
+    }
+
     [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
     inline size_t count() const noexcept {
         return this->vertices.size();
     }
 
+    /** Sum of `x^i_uv` for every edge with both ends on the same side of the cut. */
+    [[gnu::hot]]
+    inline backend::linear_expr packing_expr(uint8_t i, bool side) const {
+        const auto& inside = this->spaces[i].inside;
+        auto expr = backend::linear_expr();
+        for (unsigned u = 0; u < this->count(); u++) {
+            if (inside[u] != side) {
+                continue;
+            }
+            for (unsigned v : this->vars[i].edges.neighbours(u)) {
+                if (v > u && inside[v] == side) {
+                    expr.add(this->vars[i](u, v));
+                }
+            }
+        }
+        return expr;
+    }
+
+    [[gnu::hot]]
+    inline backend::linear_expr cutset_expr(uint8_t i, std::span<const unsigned> set) const {
+        const auto& inside = this->spaces[i].inside;
+        auto expr = backend::linear_expr();
+        for (unsigned u : set) {
+            for (unsigned v : this->vars[i].edges.neighbours(u)) {
+                if (!inside[v]) {
+                    expr.add(this->vars[i](u, v));
+                }
+            }
+        }
+        return expr;
+    }
+
+    /**
+     * Builds the elimination of the subtour on `set` into the workspace of tour `i`.
+     *
+     * Packing on `S`, packing on `V \ S` and the cutset form are equivalent under the degree
+     * constraints, so the one with fewest nonzeros is used. The sizes are counted on the edges
+     * that have a variable, which are all of them unless the model is sparse. On the complete
+     * graph the cutset has `s * t` edges, more than the smaller packing, so it only wins on sparse
+     * models. A set whose partition was already cut in this round, such as the complement of the
+     * other component of a solution with two, adds nothing.
+     */
+    [[gnu::hot]]
+    inline void add_subtour_elimination(uint8_t i, std::span<const unsigned> set) {
+        auto& space = this->spaces[i];
+        const size_t s = set.size(), t = this->count() - set.size();
+        if (s <= 0 || t <= 0) [[unlikely]] {
+            return;
+        }
+
+        std::fill(space.inside.begin(), space.inside.end(), false);
+        for (unsigned u : set) {
+            space.inside[u] = true;
+        }
+        auto partition = space.inside;
+        if (partition[0]) {
+            partition.flip();
+        }
+        if (std::ranges::find(space.separated, partition) != space.separated.end()) [[unlikely]] {
+            return;
+        }
+        space.separated.push_back(std::move(partition));
+
+        size_t packing_inside = 0, cutset = 0;
+        for (unsigned u : set) {
+            for (unsigned v : this->vars[i].edges.neighbours(u)) {
+                if (space.inside[v]) {
+                    packing_inside += 1;
+                } else {
+                    cutset += 1;
+                }
+            }
+        }
+        // every edge inside was seen from both of its ends
+        packing_inside /= 2;
+        const size_t packing_outside = this->vars[i].size() - packing_inside - cutset;
+
+        if (cutset < std::min(packing_inside, packing_outside)) {
+            space.cuts.push_back({ this->cutset_expr(i, set), backend::sense::greater_equal, 2.0 });
+            space.statistics.cutset += 1;
+            space.statistics.nonzeros += cutset;
+        } else {
+            const bool side = packing_inside <= packing_outside;
+            space.cuts.push_back({ this->packing_expr(i, side), backend::sense::less_equal, double(side ? s : t) - 1.0 });
+            space.statistics.packing += 1;
+            space.statistics.nonzeros += side ? packing_inside : packing_outside;
+        }
+    }
+
     [[gnu::hot]]
     inline void lazy_constraint_subtour_elimination(uint8_t i) {
-        auto tour = utils::min_sub_tour(this->vertices, [this, i](unsigned u, unsigned v) {
-            return this->getSolution(this->vars[i][u][v]) > 0.5;
-        });
+        const auto tours = tour::sub_tours(this->solution(i, this->spaces[i].values));
 
-        if (tour.size() >= this->count()) [[unlikely]] {
+        if (tours.size() <= 1) [[unlikely]] {
             return;
         }
 
-        auto expr = GRBLinExpr();
-        for (unsigned u = 0; u < tour.size(); u++) {
-            for (unsigned v = u + 1; v < tour.size(); v++) {
-                expr += this->vars[i][tour[u]][tour[v]];
+        const size_t limit = std::max(1U, this->options.max_lazy_cuts);
+        for (size_t t = 0; t < std::min(tours.size(), limit); t++) {
+            this->add_subtour_elimination(i, tours[t]);
+        }
+    }
+
+    /** Eliminates every set `S` whose cut `x(delta(S))` is lighter than 2 in the node relaxation. */
+    [[gnu::hot]]
+    inline void user_cut_subtour_elimination(uint8_t i) {
+        static constexpr double epsilon = 1e-4;
+        const auto& values = this->spaces[i].values;
+
+        auto support = utils::support_graph(this->count());
+        for (size_t e = 0; e < this->vars[i].size(); e++) {
+            const auto [u, v] = this->vars[i].edges[e];
+            support.set(u, v, values[e]);
+        }
+
+        auto sets = support.components(epsilon);
+        if (sets.size() <= 1) [[likely]] {
+            sets = std::move(support).light_cuts(2.0 - epsilon);
+        }
+
+        for (const auto& set : sets) {
+            this->add_subtour_elimination(i, set);
+        }
+    }
+
+    /**
+     * Separates every tour with `method`, concurrently when there is more than one.
+     *
+     * The solver context is only valid on the callback thread, so the values are fetched before
+     * and the cuts are submitted after the parallel section.
+     */
+    template <typename Separator> [[gnu::hot]]
+    inline size_t separate(backend::context& solver, bool lazy, Separator method) {
+        for (uint8_t i : this->tours) {
+            const auto& columns = this->vars[i].columns;
+            auto& values = this->spaces[i].values;
+            if (lazy) {
+                solver.solution(columns, values);
+            } else {
+                solver.relaxation(columns, values);
+            }
+        }
+
+        this->workers.run([this, method](size_t t) {
+            (this->*method)(this->tours[t]);
+        });
+
+        size_t added = 0;
+        for (uint8_t i : this->tours) {
+            auto& space = this->spaces[i];
+            added += space.cuts.size();
+            for (const auto& cut : space.cuts) {
+                if (lazy) {
+                    solver.add_lazy(cut.expr, cut.sense, cut.rhs);
+                    this->statistics.lazy += 1;
+                } else {
+                    solver.add_cut(cut.expr, cut.sense, cut.rhs);
+                    this->statistics.user += 1;
+                }
             }
+            this->statistics += space.statistics;
+            space.statistics = {};
+            space.cuts.clear();
+            space.separated.clear();
+        }
+        return added;
+    }
+
+    [[gnu::hot]]
+    inline void record_root_bound(backend::context& solver) {
+        if (solver.get(backend::info::nodes) <= 0) [[unlikely]] {
+            this->root_bound = solver.get(backend::info::bound);
+            if (solver.relaxation_solved()) [[likely]] {
+                this->timeline.root(solver.get(backend::info::runtime), *this->root_bound);
+            }
+        }
+    }
+
+    /** An integral solution without subtours is the new incumbent, if it is any better. */
+    [[gnu::hot]]
+    inline void record_incumbent(backend::context& solver) {
+        this->timeline.incumbent(
+            solver.get(backend::info::runtime),
+            solver.get(backend::info::objective),
+            solver.get(backend::info::bound),
+            solver.get(backend::info::nodes)
+        );
+    }
+
+    [[gnu::hot]]
+    inline void record_progress(backend::context& solver) {
+        this->timeline.sample(
+            solver.get(backend::info::runtime),
+            solver.get(backend::info::bound),
+            solver.get(backend::info::incumbent),
+            solver.get(backend::info::nodes)
+        );
+    }
+
+    [[gnu::hot]]
+    inline bool should_separate_fractional(backend::context& solver) {
+        return solver.relaxation_solved() && solver.get(backend::info::nodes) < this->options.fractional_nodes;
+    }
+
+    [[gnu::hot]]
+    inline bool should_inject(backend::context& solver) {
+        if (this->options.injection_interval <= 0 || !solver.relaxation_solved()) {
+            return false;
         }
-        this->addLazy(expr, GRB_LESS_EQUAL, tour.size()-1);
+        const double nodes = solver.get(backend::info::nodes);
+        if (nodes < this->next_injection) [[likely]] {
+            return false;
+        }
+        this->next_injection = nodes + this->options.injection_interval;
+        return this->injection_time <= this->options.injection_budget * solver.get(backend::info::runtime);
     }
 
-protected:
+    /** Edges at one half or more in the node relaxation, or nothing if too many are fractional. */
     [[gnu::hot]]
-    void callback() {
-        if (this->where == GRB_CB_MIPSOL) [[likely]] {
-            this->lazy_constraint_subtour_elimination(0);
-            this->lazy_constraint_subtour_elimination(1);
+    inline std::optional<std::vector<utils::edge>> support(backend::context& solver, const edge_vars& vars) {
+        static constexpr double epsilon = 1e-4;
+        auto values = std::vector<double>(vars.size());
+        solver.relaxation(vars.columns, values);
+
+        auto edges = std::vector<utils::edge>();
+        size_t fractional = 0;
+        for (size_t e = 0; e < vars.size(); e++) {
+            fractional += values[e] > epsilon && values[e] < 1.0 - epsilon;
+            if (values[e] >= 0.5) {
+                edges.push_back(vars.edges[e]);
+            }
+        }
+        if (double(fractional) > this->options.injection_fractional * double(this->count())) {
+            return std::nullopt;
+        }
+        return edges;
+    }
+
+    /** Solution values for `vars`, one for the edges where `used(u, v)` holds. */
+    [[gnu::hot]]
+    static std::vector<double> values_of(const edge_vars& vars, auto&& used) {
+        auto values = std::vector<double>();
+        values.reserve(vars.size());
+        for (auto [u, v] : vars.edges) {
+            values.push_back(used(u, v) ? 1.0 : 0.0);
+        }
+        return values;
+    }
+
+    /**
+     * Patches a nearly integral node relaxation into tours meeting the similarity bound and hands
+     * them to the solver, so that it can prune more of the tree.
+     *
+     * Attempts are spaced by `injection_interval` nodes and skipped while patching has taken more
+     * than `injection_budget` of the solve time.
+     */
+    [[gnu::hot]]
+    inline void inject_incumbent(backend::context& solver) {
+        const auto begin = std::chrono::steady_clock::now();
+        auto supports = utils::pair<std::vector<utils::edge>>();
+        auto shared = std::vector<utils::edge>();
+
+        const auto attempt = [&]() {
+            for (uint8_t i : this->tours) {
+                auto support = this->support(solver, this->vars[i]);
+                if (!support) [[likely]] {
+                    return;
+                }
+                supports[i] = std::move(*support);
+            }
+            if (this->tours.size() <= 1) {
+                // either the tours are identical or they are solved on separate models
+                supports[1 - this->tours[0]] = supports[this->tours[0]];
+            }
+            if (this->shared) {
+                auto values = std::vector<double>(this->shared->size());
+                solver.relaxation(this->shared->columns, values);
+                for (size_t e = 0; e < this->shared->size(); e++) {
+                    if (values[e] >= 0.5) {
+                        shared.push_back(this->shared->edges[e]);
+                    }
+                }
+            }
+
+            if (!this->heuristic) [[unlikely]] {
+                this->heuristic.emplace(this->costs, this->count(), this->k);
+            }
+            const auto patched = this->heuristic->patch(supports, shared);
+            if (!patched) [[unlikely]] {
+                return;
+            }
+
+            double cost = 0;
+            for (uint8_t i : this->tours) {
+                cost += tour::cost(this->costs, i, (*patched)[i]);
+            }
+            if (this->k >= this->count()) {
+                cost += tour::cost(this->costs, 1, (*patched)[1]);
+            }
+            if (cost >= solver.get(backend::info::incumbent)) [[likely]] {
+                return;
+            }
+
+            auto used = utils::pair<utils::triangular<bool>> { utils::triangular<bool>(this->count()), utils::triangular<bool>(this->count()) };
+            for (uint8_t i = 0; i <= 1; i++) {
+                const auto& path = (*patched)[i];
+                for (size_t p = 0; p < path.size(); p++) {
+                    used[i].set(path[p], path[(p + 1) % path.size()]);
+                }
+            }
+            for (uint8_t i : this->tours) {
+                const auto& path = (*patched)[i];
+                for (size_t p = 0; p < path.size(); p++) {
+                    // the heuristic may pick edges left out of a sparse model
+                    if (!this->vars[i].contains(path[p], path[(p + 1) % path.size()])) [[unlikely]] {
+                        return;
+                    }
+                }
+            }
+
+            for (uint8_t i : this->tours) {
+                const auto values = values_of(this->vars[i], [&used, i](unsigned u, unsigned v) { return used[i](u, v); });
+                solver.set_solution(this->vars[i].columns, values);
+            }
+            if (this->shared) {
+                const auto values = values_of(*this->shared, [&used](unsigned u, unsigned v) { return used[0](u, v) && used[1](u, v); });
+                solver.set_solution(this->shared->columns, values);
+            }
+            this->statistics.injected += 1;
+        };
+        attempt();
+
+        const std::chrono::duration<double> spent = std::chrono::steady_clock::now() - begin;
+        this->injection_time += spent.count();
+    }
+
+public:
+    [[gnu::hot]]
+    void operator()(backend::context& solver) override {
+        this->statistics.calls += 1;
+        if (utils::should_stop()) [[unlikely]] {
+            // the solver keeps its incumbent and bound, so the run can still be reported
+            return solver.abort();
+        }
+
+        const auto where = solver.where();
+        if (where == backend::event::solution) [[likely]] {
+            if (this->separate(solver, true, &subtour_elim::lazy_constraint_subtour_elimination) <= 0) {
+                this->record_incumbent(solver);
+            }
+
+        } else if (where == backend::event::progress) {
+            this->record_progress(solver);
+
+        } else if (where == backend::event::node) {
+            this->record_root_bound(solver);
+            if (this->should_separate_fractional(solver)) {
+                this->separate(solver, false, &subtour_elim::user_cut_subtour_elimination);
+            }
+            if (this->should_inject(solver)) [[unlikely]] {
+                this->inject_incumbent(solver);
+            }
         }
     }
 };
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+
+
+namespace utils {
+    /**
+     * Whether `value` is neither infinite nor NaN.
+     *
+     * Checked on the exponent bits, since under `-ffast-math` GCC assumes every double is finite and
+     * folds `std::isfinite` and comparisons against infinity.
+     */
+    [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+    constexpr bool is_finite(double value) noexcept {
+        constexpr uint64_t exponent = 0x7FF0000000000000;
+        return (std::bit_cast<uint64_t>(value) & exponent) != exponent;
+    }
+}
@@ -1,14 +1,24 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <exception>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
 #include <optional>
 #include <span>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
-#include <gurobi_c++.h>
+#include "backend.hpp"
 #include "vertex.hpp"
+#include "costs.hpp"
 #include "elimination.hpp"
 
 
@@ -54,81 +64,309 @@ namespace utils {
 
 
 struct graph final {
+public:
+    using clock = std::chrono::high_resolution_clock;
+    /** Set before anything else, so that building the model is timed too. */
+    const clock::time_point start = clock::now();
+
 private:
-    GRBModel model;
+    /** Environments owned by the graph, one per model when the tours are solved concurrently. */
+    std::vector<std::unique_ptr<backend::environment>> envs;
+    /** A single model with both tours, or one model per tour when they are independent. */
+    std::vector<std::unique_ptr<backend::model>> models;
+
+    [[gnu::cold]]
+    static std::vector<std::unique_ptr<backend::environment>> split_envs(const backend::environment& env, bool independent, unsigned threads) {
+        auto envs = std::vector<std::unique_ptr<backend::environment>>();
+        if (independent) {
+            if (threads <= 0) {
+                threads = std::max(1U, std::thread::hardware_concurrency());
+            }
+            for (uint8_t i = 0; i <= 1; i++) {
+                envs.push_back(env.split(std::max(1U, threads / 2)));
+            }
+        }
+        return envs;
+    }
+
+    [[gnu::cold]]
+    inline std::vector<std::unique_ptr<backend::model>> make_models(const backend::environment& env, unsigned threads) const {
+        auto models = std::vector<std::unique_ptr<backend::model>>();
+        if (this->envs.empty()) {
+            models.push_back(env.make_model());
+            if (threads > 0) {
+                models.back()->threads(threads);
+            }
+        }
+        for (const auto& split : this->envs) {
+            models.push_back(split->make_model());
+        }
+        return models;
+    }
+
+    /** Model holding the variables of tour `i`. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline backend::model& model(uint8_t i = 0) const noexcept {
+        return *this->models[std::min<size_t>(i, this->models.size() - 1)];
+    }
+
+    [[gnu::cold]]
+    inline double sum(backend::attribute attr) const {
+        double total = 0;
+        for (const auto& model : this->models) {
+            total += model->get(attr);
+        }
+        return total;
+    }
+
+    /** Variable names for every edge of `edges`, only built on debug builds. */
+    [[gnu::cold]]
+    inline std::vector<std::string> edge_names(const std::string& prefix, const utils::edge_set& edges) const {
+#ifdef DEBUG
+        auto names = std::vector<std::string>();
+        names.reserve(edges.size());
+
+        for (auto [u, v] : edges) {
+            std::ostringstream name;
+            name << prefix << '_' << this->vertices[u].id() << '_' << this->vertices[v].id();
+            names.push_back(name.str());
+        }
+        return names;
+#else
+        (void) prefix;
+        (void) edges;
+        return {};
+#endif
+    }
+
+    /** Adds one binary variable per edge of `edges`, in the order of the set, with a single call. */
+    [[gnu::cold]]
+    inline edge_vars add_edge_vars(uint8_t i, const std::string& prefix, utils::edge_set edges, const std::vector<double>& objective) {
+        const auto first = this->model(i).add_binaries(objective, this->edge_names(prefix, edges));
+
+        auto columns = std::vector<backend::column>(edges.size());
+        std::iota(columns.begin(), columns.end(), first);
+        return edge_vars(std::move(edges), std::move(columns));
+    }
+
+    [[gnu::cold]]
+    inline edge_vars add_vars(uint8_t i, const utils::edge_set& edges) {
+        auto objective = std::vector<double>();
+        objective.reserve(edges.size());
+
+        for (auto [u, v] : edges) {
+            objective.push_back(this->costs(i, u, v));
+        }
+        return this->add_edge_vars(i, "x" + std::to_string(i + 1), edges, objective);
+    }
 
+    /**
+     * Variables for both tours, over the candidate `edges` of each.
+     *
+     * When every edge must be shared the tours coincide, so a single set of variables priced at
+     * `c1 + c2` stands for both and the problem is a plain TSP.
+     */
     [[gnu::cold]]
-    inline GRBVar add_edge(uint8_t i, const vertex& u, const vertex& v) {
-        std::ostringstream name;
-        name << 'x' << i << '_' << u.id() << '_' << v.id();
+    inline utils::pair<edge_vars> add_tours(const utils::pair<utils::edge_set>& edges) {
+        if (!this->identical) [[likely]] {
+            return { this->add_vars(0, edges[0]), this->add_vars(1, edges[1]) };
+        }
 
-        double objective = u[i].cost(v[i]);
-        return this->model.addVar(0., 1., objective, GRB_BINARY, name.str());
+        auto both = utils::edge_set::intersection(edges[0], edges[1]);
+        auto objective = std::vector<double>();
+        objective.reserve(both.size());
+        for (auto [u, v] : both) {
+            objective.push_back(this->costs(0, u, v) + this->costs(1, u, v));
+        }
+        auto vars = this->add_edge_vars(0, "x", std::move(both), objective);
+        return { vars, vars };
     }
 
+    /** One row per vertex, summing the variables of its edges in `vars`. */
     [[gnu::cold]]
-    inline utils::matrix<GRBVar> add_vars(uint8_t i) {
-        auto vars = utils::matrix<GRBVar>(this->order());
+    inline std::vector<backend::linear_expr> degree_exprs(const edge_vars& vars) const {
+        auto exprs = std::vector<backend::linear_expr>(this->order());
 
         for (unsigned u = 0; u < this->order(); u++) {
-            for (unsigned v = u + 1; v < this->order(); v++) {
-                auto xi_uv = this->add_edge(i, this->vertices[u], this->vertices[v]);
-                vars[u][v] = xi_uv;
-                vars[v][u] = xi_uv;
+            for (unsigned v : vars.edges.neighbours(u)) {
+                exprs[u].add(vars(u, v));
             }
         }
-        return vars;
+        return exprs;
     }
 
     [[gnu::cold]]
     inline void add_constraint_deg_2(uint8_t i) {
-        for (unsigned u = 0; u < this->order(); u++) {
-            auto expr = GRBLinExpr();
-            for (unsigned v = 0; v < this->order(); v++) {
-                if (u != v) [[likely]] {
-                    expr += this->vars[i][u][v];
-                }
-            }
-            this->model.addConstr(expr, GRB_EQUAL, 2.);
+        this->model(i).add_constrs(this->degree_exprs(this->vars[i]), backend::sense::equal, 2.);
+    }
+
+    /** Links the shared edge variables to both tours, `x^i_e >= z_e`. */
+    [[gnu::cold]]
+    inline void add_constraint_coupling(uint8_t i, const edge_vars& shared) {
+        auto exprs = std::vector<backend::linear_expr>(shared.size());
+
+        for (size_t e = 0; e < shared.size(); e++) {
+            const auto [u, v] = shared.edges[e];
+            exprs[e].add(this->vars[i](u, v), 1.0);
+            exprs[e].add(shared[e], -1.0);
         }
+        this->model().add_constrs(exprs, backend::sense::greater_equal, 0.);
     }
 
+    /**
+     * Marks as shared every edge used by both tours, `z_e >= x^1_e + x^2_e - 1`.
+     *
+     * Not implied by the coupling, which only bounds `z` from above, and valid since raising `z`
+     * to the intersection keeps any solution feasible. As `z` has no cost it cannot raise the bound
+     * of the first relaxation, but it ties `z` to the tours for presolve, cuts and branching.
+     */
     [[gnu::cold]]
-    inline GRBVar add_shared_edge(unsigned u, unsigned v) {
-        std::ostringstream name;
-        name << 'z' << '_' << this->vertices[u].id() << '_' << this->vertices[v].id();
-        auto ze = this->model.addVar(0., 1., 0.0, GRB_BINARY, name.str());
+    inline void add_constraint_intersection(const edge_vars& shared) {
+        auto exprs = std::vector<backend::linear_expr>(shared.size());
+
+        for (size_t e = 0; e < shared.size(); e++) {
+            const auto [u, v] = shared.edges[e];
+            exprs[e].add(this->vars[0](u, v), 1.0);
+            exprs[e].add(this->vars[1](u, v), 1.0);
+            exprs[e].add(shared[e], -1.0);
+        }
+        this->model().add_constrs(exprs, backend::sense::less_equal, 1.);
+    }
 
-        this->model.addConstr(this->vars[0][u][v], GRB_GREATER_EQUAL, ze);
-        return ze;
+    /** Shared edges can only be edges available to both tours. */
+    [[gnu::cold]]
+    inline void add_constraint_similarity(double k, bool strengthen) {
+        auto both = utils::edge_set::intersection(this->vars[0].edges, this->vars[1].edges);
+        const auto zeros = std::vector<double>(both.size(), 0.0);
+        const auto& shared = this->shared.emplace(this->add_edge_vars(0, "z", std::move(both), zeros));
+        this->add_constraint_coupling(0, shared);
+        this->add_constraint_coupling(1, shared);
+        if (strengthen) {
+            this->add_constraint_intersection(shared);
+        }
+
+        auto expr = backend::linear_expr();
+        for (backend::column var : shared.columns) {
+            expr.add(var);
+        }
+        this->model().add_constrs(std::span(&expr, 1), backend::sense::greater_equal, k);
+    }
+
+    /** Shared edge variables `z`, only present when the tours are coupled. */
+    std::optional<edge_vars> shared;
+    /** Values of the variables of each tour in the best solution, read once the solve ends. */
+    utils::pair<std::vector<double>> values;
+
+    /** What the subtour callback gathered during one solve. */
+    struct callback_results final {
+        cut_statistics statistics;
+        std::optional<double> root;
+        utils::timeline timeline;
+    };
+
+    /** Solves `model` with subtour elimination on `tours`, returning what the callback gathered. */
+    [[gnu::hot]]
+    inline callback_results optimize(backend::model& model, std::vector<uint8_t> tours, const subtour_options& options) const {
+        auto callback = subtour_elim(this->vertices, this->costs, this->vars, this->shared, this->k, std::move(tours), options);
+
+        model.optimize(callback);
+        return { callback.statistics, callback.root_bound, std::move(callback.timeline) };
     }
 
     [[gnu::cold]]
-    inline void add_constraint_similarity(double k) {
-        auto expr = GRBLinExpr();
-        for (unsigned u = 0; u < this->order(); u++) {
-            for (unsigned v = u + 1; v < this->order(); v++) {
-                expr += this->add_shared_edge(u, v);
+    inline void keep(callback_results&& results) {
+        this->statistics = results.statistics;
+        this->root = results.root;
+        this->progress = std::move(results.timeline);
+    }
+
+    /** Solves each tour on its own thread, since no constraint links them. */
+    [[gnu::hot]]
+    inline void optimize_concurrently(const subtour_options& options) {
+        auto results = utils::pair<std::optional<callback_results>>();
+        auto errors = utils::pair<std::exception_ptr>();
+        auto threads = std::vector<std::thread>();
+
+        for (uint8_t i = 0; i <= 1; i++) {
+            threads.emplace_back([this, i, &options, &results, &errors] {
+                try {
+                    results[i] = this->optimize(this->model(i), { i }, options);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (const auto& error : errors) {
+            if (error) [[unlikely]] {
+                std::rethrow_exception(error);
             }
         }
-        this->model.addConstr(expr, GRB_GREATER_EQUAL, k);
+
+        this->keep(std::move(*results[0]));
+        this->statistics += results[1]->statistics;
+        if (this->root && results[1]->root) [[likely]] {
+            this->root = *this->root + *results[1]->root;
+        } else {
+            this->root = std::nullopt;
+        }
+        this->progress.merge(results[1]->timeline, 1);
     }
 
 public:
+    /**
+     * Builds the kSTSP model for `vertices`.
+     *
+     * With `k = 0` the tours are independent and each gets its own model, split from `env` and
+     * solved concurrently with half of the `threads` (all cores if zero). With `k >= |V|` both
+     * tours must be the same, so the model is a single TSP on the summed costs.
+     *
+     * Each tour only gets variables for its `edges`, every edge of the complete graph if not given.
+     * The optimum of such a sparse model is only optimal for the whole graph if the missing edges
+     * are proven useless, see `pricing.hpp`.
+     */
     [[gnu::cold]]
-    graph(std::span<const vertex> vertices, const GRBEnv& env, unsigned k = 0):
-        model(env), vertices(vertices), vars({ this->add_vars(0), this->add_vars(1) })
+    graph(
+        std::span<const vertex> vertices,
+        const ::costs& costs,
+        const backend::environment& env,
+        unsigned k = 0,
+        bool strengthen = false,
+        unsigned threads = 0,
+        std::optional<utils::pair<utils::edge_set>> edges = std::nullopt
+    ):
+        envs(split_envs(env, k <= 0, threads)), models(this->make_models(env, threads)),
+        vertices(vertices), costs(costs), k(k), identical(k >= vertices.size()),
+        vars(this->add_tours(edges.value_or(utils::pair<utils::edge_set> {
+            utils::edge_set::complete(vertices.size()), utils::edge_set::complete(vertices.size())
+        })))
     {
         this->add_constraint_deg_2(0);
-        this->add_constraint_deg_2(1);
-        if (k > 0) {
-            this->add_constraint_similarity(k);
+        if (!this->identical) [[likely]] {
+            this->add_constraint_deg_2(1);
+            if (k > 0) {
+                this->add_constraint_similarity(k, strengthen);
+            }
         }
-        this->model.update();
+        for (auto& model : this->models) {
+            model->update();
+        }
+        this->build_time = this->elapsed();
     }
 
     const std::span<const vertex> vertices;
-    const  utils::pair<utils::matrix<GRBVar>> vars;
+    const ::costs& costs;
+    /** Minimum number of shared edges. */
+    const unsigned k;
+    cut_statistics statistics;
+    std::optional<double> root;
+    /** Root relaxation, incumbents and bound samples of the last solve. */
+    utils::timeline progress;
+    /** Whether both tours are forced to be the same (`k >= |V|`) and share their variables. */
+    const bool identical;
+    const utils::pair<edge_vars> vars;
 
     /** Number of vertices. */
     [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
@@ -136,15 +374,27 @@ public:
         return this->vertices.size();
     }
 
-    /** Number of edges. */
+    /** Number of edges of the complete graph. */
     [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
     inline size_t size() const noexcept {
         const size_t order = this->order();
         return (order * (order - 1)) / 2;
     }
 
-    using clock = std::chrono::high_resolution_clock;
-    const clock::time_point start = clock::now();
+    /** Candidate edges of tour `i`, the ones with a variable. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline const utils::edge_set& edge_set(uint8_t i) const noexcept {
+        return this->vars[i].edges;
+    }
+
+    /** Whether some edge of the complete graph has no variable in either tour. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline bool is_sparse() const noexcept {
+        return !this->edge_set(0).is_complete() || !this->edge_set(1).is_complete();
+    }
+
+    /** Seconds spent creating variables and constraints. */
+    double build_time = 0;
 
     [[gnu::cold]] [[gnu::nothrow]]
     inline double elapsed() const noexcept {
@@ -153,43 +403,117 @@ public:
         return secs.count();
     }
 
+    /** Whether each tour is solved on a separate model. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline bool is_split() const noexcept {
+        return this->models.size() > 1;
+    }
+
+    /** Solver status, or the first one that is not optimal when the tours are split. */
+    [[gnu::pure]] [[gnu::cold]]
+    backend::status status() const {
+        for (const auto& model : this->models) {
+            if (const auto status = model->result(); status != backend::status::optimal) [[unlikely]] {
+                return status;
+            }
+        }
+        return backend::status::optimal;
+    }
+
+    /** Whether the solve ended on the time limit or an interrupt instead of finishing. */
+    [[gnu::pure]] [[gnu::cold]]
+    bool stopped() const {
+        const auto status = this->status();
+        return status == backend::status::time_limit || status == backend::status::interrupted;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    std::string_view status_name() const {
+        return backend::status_name(this->status());
+    }
+
     [[gnu::pure]] [[gnu::cold]]
     int64_t solution_count() const {
-        return this->model.get(GRB_IntAttr_SolCount);
+        int64_t count = std::numeric_limits<int64_t>::max();
+        for (const auto& model : this->models) {
+            count = std::min<int64_t>(count, model->get(backend::attribute::solutions));
+        }
+        return count;
     }
 
+    /** Runs the solver, returning the seconds spent in it. */
     [[gnu::hot]]
-    double solve() {
-        auto callback = subtour_elim(this->vertices, this->vars);
-        this->model.setCallback(&callback);
-
-        this->model.optimize();
-        auto total_time = this->elapsed();
+    double solve(subtour_options options = {}) {
+        const auto begin = clock::now();
+        if (this->is_split()) {
+            this->optimize_concurrently(options);
+        } else {
+            const auto tours = this->identical ? std::vector<uint8_t> { 0 } : std::vector<uint8_t> { 0, 1 };
+            this->keep(this->optimize(this->model(), tours, options));
+        }
+        const std::chrono::duration<double> solve_time = clock::now() - begin;
 
+        // a run cut short by the time limit or an interrupt is still reported, even without a tour
         if (this->solution_count() <= 0) [[unlikely]] {
-            throw utils::invalid_solution::zero_solutions(this->vertices);
+            if (!this->stopped()) {
+                throw utils::invalid_solution::zero_solutions(this->vertices);
+            }
+            return solve_time.count();
+        }
+
+        // read once, since every other query of the solution goes through `edge`
+        for (uint8_t i = 0; i <= 1; i++) {
+            this->values[i].resize(this->vars[i].size());
+            this->model(i).solution(this->vars[i].columns, this->values[i]);
         }
-        return total_time;
+        return solve_time.count();
+    }
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline const cut_statistics& cuts() const noexcept {
+        return this->statistics;
+    }
+
+    /** Best bound known while still at the root node, after its cutting planes. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline std::optional<double> root_bound() const noexcept {
+        return this->root;
+    }
+
+    /** Objective of the first relaxation solved at the root, if the solve reached it. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline std::optional<double> root_lp() const noexcept {
+        return this->progress.root_lp;
+    }
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline const utils::timeline& timeline() const noexcept {
+        return this->progress;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    int64_t node_count() const {
+        return this->sum(backend::attribute::nodes);
     }
 
     [[gnu::pure]] [[gnu::cold]]
     int64_t iterations() const {
-        return this->model.get(GRB_DoubleAttr_IterCount);
+        return this->sum(backend::attribute::iterations);
     }
 
     [[gnu::pure]] [[gnu::cold]]
     int64_t var_count() const {
-        return this->model.get(GRB_IntAttr_NumVars);
+        return this->sum(backend::attribute::variables);
     }
 
     [[gnu::pure]] [[gnu::cold]]
     int64_t lin_constr_count() const {
-        return this->model.get(GRB_IntAttr_NumConstrs);
+        return this->sum(backend::attribute::constraints);
     }
 
     [[gnu::pure]] [[gnu::cold]]
     int64_t quad_constr_count() const {
-        return this->model.get(GRB_IntAttr_NumQConstrs);
+        return this->sum(backend::attribute::quadratic_constraints);
     }
 
     [[gnu::pure]] [[gnu::cold]]
@@ -199,30 +523,80 @@ public:
 
     [[gnu::pure]] [[gnu::cold]]
     double solution_cost() const {
-        return this->model.get(GRB_DoubleAttr_ObjVal);
+        return this->sum(backend::attribute::objective);
+    }
+
+    /** Best proven lower bound on the objective. */
+    [[gnu::pure]] [[gnu::cold]]
+    double lower_bound() const {
+        return this->sum(backend::attribute::bound);
+    }
+
+    /**
+     * Installs `tours` as the MIP start, giving the solver an incumbent before it explores any node.
+     *
+     * Shared edges are started at one exactly where both tours use the edge.
+     */
+    [[gnu::cold]]
+    void warm_start(const utils::pair<tour>& tours) {
+        auto used = utils::pair<utils::triangular<bool>> { utils::triangular<bool>(this->order()), utils::triangular<bool>(this->order()) };
+        for (uint8_t i = 0; i <= 1; i++) {
+            for (size_t p = 0; p < tours[i].size(); p++) {
+                used[i].set(tours[i][p], tours[i][(p + 1) % tours[i].size()]);
+            }
+        }
+        const auto start = [&used](const edge_vars& vars, auto&& value) {
+            auto values = std::vector<double>();
+            values.reserve(vars.size());
+            for (auto [u, v] : vars.edges) {
+                values.push_back(value(u, v) ? 1.0 : 0.0);
+            }
+            return values;
+        };
+
+        const uint8_t layers = this->identical ? 1 : 2;
+        for (uint8_t i = 0; i < layers; i++) {
+            const auto values = start(this->vars[i], [&used, i](unsigned u, unsigned v) { return used[i](u, v); });
+            this->model(i).start(this->vars[i].columns, values);
+        }
+        if (this->shared) {
+            const auto both = start(*this->shared, [&used](unsigned u, unsigned v) { return used[0](u, v) && used[1](u, v); });
+            this->model().start(this->shared->columns, both);
+        }
+    }
+
+    /** Stops each solve after `seconds` of wall clock time, keeping the best solution found. */
+    [[gnu::cold]]
+    void time_limit(double seconds) {
+        for (auto& model : this->models) {
+            model->time_limit(seconds);
+        }
     }
 
+    /** Whether tour `i` uses edge `(u, v)` in the solution of the last solve. */
     [[gnu::pure]] [[gnu::hot]]
     inline bool edge(uint8_t i, unsigned u, unsigned v) const {
-        if (u != v) [[likely]] {
-            return this->vars[i][u][v].get(GRB_DoubleAttr_X) > 0.5;
+        if (this->vars[i].contains(u, v) && !this->values[i].empty()) [[likely]] {
+            return this->values[i][this->vars[i].position(u, v)] > 0.5;
         } else {
             return false;
         }
     }
 
     [[gnu::pure]] [[gnu::cold]]
-    auto edges(uint8_t i) const {
-        return utils::get_solutions(this->order(), [this, i](unsigned u, unsigned v) {
-            return this->edge(i, u, v);
-        });
+    utils::adjacency edges(uint8_t i) const {
+        auto adjacency = utils::adjacency(this->order());
+        for (auto [u, v] : this->edge_set(i)) {
+            if (this->edge(i, u, v)) {
+                adjacency.add(u, v);
+            }
+        }
+        return adjacency;
     }
 
     [[gnu::pure]] [[gnu::cold]]
     auto tour(uint8_t i) const {
-        auto min = utils::min_sub_tour(this->vertices, [this, i](unsigned u, unsigned v) {
-            return this->edge(i, u, v);
-        });
+        auto min = tour::min_sub_tour(this->edges(i));
 
         if (min.size() != this->order()) [[unlikely]] {
             throw utils::invalid_solution::incomplete_tour(this->vertices, min);
@@ -230,15 +604,17 @@ public:
         return min;
     }
 
+    [[gnu::pure]] [[gnu::cold]]
+    int64_t tour_cost(uint8_t i) const {
+        return tour::cost(this->costs, i, this->tour(i));
+    }
+
     [[gnu::pure]] [[gnu::cold]]
     unsigned similarity() const {
         unsigned total = 0;
-        for (unsigned u = 0; u < this->order(); u++) {
-            for (unsigned v = u + 1; v < this->order(); v++) {
-
-                if (this->edge(0, u, v) && this->edge(1, u, v)) [[unlikely]] {
-                    total += 1;
-                }
+        for (auto [u, v] : this->edge_set(0)) {
+            if (this->edge(0, u, v) && this->edge(1, u, v)) [[unlikely]] {
+                total += 1;
             }
         }
         return total;
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <gurobi_c++.h>
+#include "backend.hpp"
+
+
+namespace backend {
+    /** Gurobi model, with its variables kept in column order. */
+    struct gurobi_model final : public model {
+    private:
+        /** Mutable since Gurobi reads attributes through non-const methods. */
+        mutable GRBModel inner;
+        std::vector<GRBVar> vars;
+
+        [[gnu::hot]]
+        inline void gather(std::span<const column> columns, std::vector<GRBVar>& out) const {
+            out.clear();
+            out.reserve(columns.size());
+            for (column var : columns) {
+                out.push_back(this->vars[var]);
+            }
+        }
+
+        [[gnu::hot]]
+        inline GRBLinExpr expr(const linear_expr& expr, std::vector<GRBVar>& scratch) const {
+            this->gather(expr.columns, scratch);
+            auto result = GRBLinExpr();
+            result.addTerms(expr.coefficients.data(), scratch.data(), expr.size());
+            return result;
+        }
+
+        /** Adapts a `backend::callback` to Gurobi, with one scratch buffer for the variables of each call. */
+        struct adapter final : public GRBCallback, public context {
+        private:
+            const gurobi_model& owner;
+            backend::callback& inner;
+            std::vector<GRBVar> scratch;
+
+            [[gnu::hot]]
+            inline void copy(std::unique_ptr<double[]> fetched, std::span<double> values) const {
+                std::copy(fetched.get(), fetched.get() + values.size(), values.begin());
+            }
+
+        public:
+            [[gnu::cold]]
+            adapter(const gurobi_model& owner, backend::callback& inner): GRBCallback(), owner(owner), inner(inner) { }
+
+            [[gnu::hot]]
+            event where() const override {
+                switch (GRBCallback::where) {
+                    case GRB_CB_MIP:
+                        return event::progress;
+                    case GRB_CB_MIPSOL:
+                        return event::solution;
+                    case GRB_CB_MIPNODE:
+                        return event::node;
+                    default:
+                        return event::other;
+                }
+            }
+
+            [[gnu::hot]]
+            double get(info what) override {
+                static constexpr int codes[][info_count - 1] = {
+                    { GRB_CB_MIP_NODCNT, GRB_CB_MIP_OBJBST, GRB_CB_MIP_OBJBND, GRB_CB_MIP_OBJBST },
+                    { GRB_CB_MIPSOL_NODCNT, GRB_CB_MIPSOL_OBJBST, GRB_CB_MIPSOL_OBJBND, GRB_CB_MIPSOL_OBJ },
+                    { GRB_CB_MIPNODE_NODCNT, GRB_CB_MIPNODE_OBJBST, GRB_CB_MIPNODE_OBJBND, GRB_CB_MIPNODE_OBJBST },
+                };
+                if (what == info::runtime) {
+                    return this->getDoubleInfo(GRB_CB_RUNTIME);
+                } else if (this->where() == event::other) [[unlikely]] {
+                    return std::numeric_limits<double>::quiet_NaN();
+                }
+
+                const double value = this->getDoubleInfo(codes[size_t(this->where())][size_t(what) - 1]);
+                if (what == info::incumbent && value >= GRB_INFINITY) [[unlikely]] {
+                    return std::numeric_limits<double>::infinity();
+                }
+                return value;
+            }
+
+            [[gnu::hot]]
+            bool relaxation_solved() override {
+                return this->getIntInfo(GRB_CB_MIPNODE_STATUS) == GRB_OPTIMAL;
+            }
+
+            [[gnu::hot]]
+            void solution(std::span<const column> columns, std::span<double> values) override {
+                this->owner.gather(columns, this->scratch);
+                this->copy(std::unique_ptr<double[]>(this->getSolution(this->scratch.data(), columns.size())), values);
+            }
+
+            [[gnu::hot]]
+            void relaxation(std::span<const column> columns, std::span<double> values) override {
+                this->owner.gather(columns, this->scratch);
+                this->copy(std::unique_ptr<double[]>(this->getNodeRel(this->scratch.data(), columns.size())), values);
+            }
+
+            [[gnu::hot]]
+            void add_lazy(const linear_expr& expr, sense sense, double rhs) override {
+                this->addLazy(this->owner.expr(expr, this->scratch), char(sense), rhs);
+            }
+
+            [[gnu::hot]]
+            void add_cut(const linear_expr& expr, sense sense, double rhs) override {
+                this->addCut(this->owner.expr(expr, this->scratch), char(sense), rhs);
+            }
+
+            [[gnu::hot]]
+            void set_solution(std::span<const column> columns, std::span<const double> values) override {
+                this->owner.gather(columns, this->scratch);
+                this->setSolution(this->scratch.data(), values.data(), columns.size());
+            }
+
+            [[gnu::cold]]
+            void abort() override {
+                GRBCallback::abort();
+            }
+
+        protected:
+            [[gnu::hot]]
+            void callback() override {
+                this->inner(*this);
+            }
+        };
+
+    public:
+        [[gnu::cold]]
+        explicit gurobi_model(const GRBEnv& env): inner(env) { }
+
+        [[gnu::cold]]
+        column add_binaries(std::span<const double> objective, std::span<const std::string> names = {}) override {
+            const auto upper = std::vector<double>(objective.size(), 1.0);
+            const auto types = std::vector<char>(objective.size(), GRB_BINARY);
+
+            const auto added = std::unique_ptr<GRBVar[]>(this->inner.addVars(
+                nullptr, upper.data(), objective.data(), types.data(), names.empty() ? nullptr : names.data(), objective.size()
+            ));
+            const column first = this->vars.size();
+            this->vars.insert(this->vars.end(), added.get(), added.get() + objective.size());
+            return first;
+        }
+
+        [[gnu::cold]]
+        void add_constrs(std::span<const linear_expr> exprs, sense sense, double rhs) override {
+            auto rows = std::vector<GRBLinExpr>();
+            rows.reserve(exprs.size());
+            auto scratch = std::vector<GRBVar>();
+            for (const auto& expr : exprs) {
+                rows.push_back(this->expr(expr, scratch));
+            }
+            const auto senses = std::vector<char>(exprs.size(), char(sense));
+            const auto rhss = std::vector<double>(exprs.size(), rhs);
+
+            const auto added = std::unique_ptr<GRBConstr[]>(this->inner.addConstrs(
+                rows.data(), senses.data(), rhss.data(), nullptr, rows.size()
+            ));
+        }
+
+        [[gnu::cold]]
+        void update() override {
+            this->inner.update();
+        }
+
+        [[gnu::cold]]
+        void threads(unsigned count) override {
+            this->inner.set(GRB_IntParam_Threads, count);
+        }
+
+        [[gnu::cold]]
+        void time_limit(double seconds) override {
+            this->inner.set(GRB_DoubleParam_TimeLimit, seconds);
+        }
+
+        [[gnu::cold]]
+        void start(std::span<const column> columns, std::span<const double> values) override {
+            auto vars = std::vector<GRBVar>();
+            this->gather(columns, vars);
+            this->inner.set(GRB_DoubleAttr_Start, vars.data(), values.data(), values.size());
+        }
+
+        [[gnu::hot]]
+        void optimize(callback& callback) override {
+            auto solver = adapter(*this, callback);
+            this->inner.setCallback(&solver);
+            this->inner.optimize();
+        }
+
+        [[gnu::pure]] [[gnu::cold]]
+        status result() const override {
+            switch (this->inner.get(GRB_IntAttr_Status)) {
+                case GRB_OPTIMAL:
+                    return status::optimal;
+                case GRB_TIME_LIMIT:
+                    return status::time_limit;
+                case GRB_INTERRUPTED:
+                    return status::interrupted;
+                case GRB_INFEASIBLE:
+                    return status::infeasible;
+                default:
+                    return status::unknown;
+            }
+        }
+
+        [[gnu::pure]] [[gnu::cold]]
+        double get(attribute what) const override {
+            switch (what) {
+                case attribute::solutions:
+                    return this->inner.get(GRB_IntAttr_SolCount);
+                case attribute::nodes:
+                    return this->inner.get(GRB_DoubleAttr_NodeCount);
+                case attribute::iterations:
+                    return this->inner.get(GRB_DoubleAttr_IterCount);
+                case attribute::variables:
+                    return this->inner.get(GRB_IntAttr_NumVars);
+                case attribute::constraints:
+                    return this->inner.get(GRB_IntAttr_NumConstrs);
+                case attribute::quadratic_constraints:
+                    return this->inner.get(GRB_IntAttr_NumQConstrs);
+                case attribute::objective:
+                    return this->inner.get(GRB_DoubleAttr_ObjVal);
+                case attribute::bound:
+                    return this->inner.get(GRB_DoubleAttr_ObjBound);
+            }
+            return 0;
+        }
+
+        [[gnu::cold]]
+        void solution(std::span<const column> columns, std::span<double> values) const override {
+            auto vars = std::vector<GRBVar>();
+            this->gather(columns, vars);
+            const auto fetched = std::unique_ptr<double[]>(this->inner.get(GRB_DoubleAttr_X, vars.data(), vars.size()));
+            std::copy(fetched.get(), fetched.get() + values.size(), values.begin());
+        }
+    };
+
+    /** Gurobi environment, silent and with lazy constraints enabled. */
+    struct gurobi_environment final : public environment {
+    private:
+        [[gnu::cold]]
+        static GRBEnv quiet_env(unsigned threads) {
+            auto env = GRBEnv(true);
+            env.set(GRB_IntParam_OutputFlag, 0);
+            env.set(GRB_IntParam_LazyConstraints, 1);
+            env.set(GRB_IntParam_PreCrush, 1);
+            if (threads > 0) {
+                env.set(GRB_IntParam_Threads, threads);
+            }
+            env.start();
+            return env;
+        }
+
+        GRBEnv env;
+
+    public:
+        /** Starts a new environment, which checks the licence, using `threads` (all cores if zero). */
+        [[gnu::cold]]
+        explicit gurobi_environment(unsigned threads = 0): env(quiet_env(threads)) { }
+
+        [[gnu::cold]]
+        std::unique_ptr<model> make_model() const override {
+            return std::make_unique<gurobi_model>(this->env);
+        }
+
+        /** Gurobi environments are not thread safe, so each concurrent model gets its own. */
+        [[gnu::cold]]
+        std::unique_ptr<environment> split(unsigned threads) const override {
+            return std::make_unique<gurobi_environment>(threads);
+        }
+    };
+}
@@ -0,0 +1,751 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "vertex.hpp"
+#include "costs.hpp"
+#include "tour.hpp"
+#include "one_tree.hpp"
+#include "edges.hpp"
+
+
+namespace utils {
+    /** Grows vertex-disjoint paths one edge at a time, rejecting edges that would close a cycle. */
+    struct path_builder final {
+    private:
+        std::vector<std::array<unsigned, 2>> neighbors;
+        std::vector<uint8_t> degree;
+        std::vector<unsigned> parent;
+        size_t count = 0;
+
+        [[gnu::hot]] [[gnu::nothrow]]
+        inline unsigned find(unsigned u) noexcept {
+            while (this->parent[u] != u) {
+                this->parent[u] = this->parent[this->parent[u]];
+                u = this->parent[u];
+            }
+            return u;
+        }
+
+    public:
+        [[gnu::hot]]
+        explicit inline path_builder(size_t order): neighbors(order), degree(order, 0), parent(order) {
+            std::iota(this->parent.begin(), this->parent.end(), 0);
+        }
+
+        /** Number of vertices. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline size_t order() const noexcept {
+            return this->degree.size();
+        }
+
+        /** Number of edges in the paths. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline size_t size() const noexcept {
+            return this->count;
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline std::span<const unsigned> adjacent(unsigned u) const noexcept {
+            return std::span<const unsigned>(this->neighbors[u].data(), this->degree[u]);
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline bool complete() const noexcept {
+            return this->size() + 1 >= this->order();
+        }
+
+        [[gnu::hot]] [[gnu::nothrow]]
+        inline bool add(unsigned u, unsigned v) noexcept {
+            if (u == v || this->degree[u] >= 2 || this->degree[v] >= 2) {
+                return false;
+            }
+            const unsigned ru = this->find(u), rv = this->find(v);
+            if (ru == rv) {
+                return false;
+            }
+
+            this->parent[ru] = rv;
+            this->neighbors[u][this->degree[u]++] = v;
+            this->neighbors[v][this->degree[v]++] = u;
+            this->count += 1;
+            return true;
+        }
+
+        /** Adds edges from `edges` in order until the paths form a single Hamiltonian path. */
+        template <std::ranges::input_range Edges> [[gnu::hot]]
+        inline void extend(const Edges& edges) noexcept {
+            for (auto [u, v] : edges) {
+                if (this->complete()) [[unlikely]] {
+                    return;
+                }
+                this->add(u, v);
+            }
+        }
+
+        /** Walks the Hamiltonian path, which is implicitly closed into a tour. */
+        [[gnu::hot]]
+        inline tour walk() const {
+            auto path = tour();
+            path.reserve(this->order());
+
+            unsigned start = 0;
+            while (start < this->order() && this->degree[start] >= 2) {
+                start += 1;
+            }
+            if (start >= this->order()) [[unlikely]] {
+                return path;
+            }
+
+            unsigned previous = start, current = start;
+            do {
+                path.push_back(current);
+                unsigned next = current;
+                for (uint8_t d = 0; d < this->degree[current]; d++) {
+                    if (this->neighbors[current][d] != previous) {
+                        next = this->neighbors[current][d];
+                    }
+                }
+                previous = current;
+                current = next;
+            } while (current != previous && path.size() < this->order());
+            return path;
+        }
+    };
+}
+
+
+/** 2-opt over candidate neighbor lists, never removing edges marked as fixed. */
+struct two_opt final {
+private:
+    const utils::cost_table& costs;
+    const std::vector<unsigned>& candidates;
+    const size_t width;
+    const utils::triangular<bool>& fixed;
+
+    tour& path;
+    std::vector<unsigned> position;
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t order() const noexcept {
+        return this->path.size();
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline unsigned at(long idx) const noexcept {
+        const long n = this->order();
+        return this->path[((idx % n) + n) % n];
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool is_fixed(unsigned u, unsigned v) const noexcept {
+        return this->fixed(u, v);
+    }
+
+    /** Reverses the cyclic segment from position `i` to `j`, or its complement if that is shorter. */
+    [[gnu::hot]] [[gnu::nothrow]]
+    inline void reverse(size_t i, size_t j) noexcept {
+        const size_t n = this->order();
+        size_t len = (j + n - i) % n + 1;
+        if (2 * len > n) {
+            std::swap(i, j);
+            i = (i + 1) % n;
+            j = (j + n - 1) % n;
+            len = n - len;
+        }
+
+        for (size_t s = 0; s < len / 2; s++) {
+            const size_t a = (i + s) % n, b = (j + n - s) % n;
+            std::swap(this->path[a], this->path[b]);
+            this->position[this->path[a]] = a;
+            this->position[this->path[b]] = b;
+        }
+    }
+
+    /** Applies the first improving move touching `a`, returning the endpoints of the exchanged edges. */
+    [[gnu::hot]] [[gnu::nothrow]]
+    inline std::optional<std::array<unsigned, 4>> improve(unsigned a) noexcept {
+        const long i = this->position[a];
+
+        for (int dir : { +1, -1 }) {
+            const unsigned b = this->at(i + dir);
+            if (this->is_fixed(a, b)) {
+                continue;
+            }
+            const int32_t ab = this->costs(a, b);
+
+            for (size_t r = 0; r < this->width; r++) {
+                const unsigned c = this->candidates[a * this->width + r];
+                const int32_t ac = this->costs(a, c);
+                if (ac >= ab) {
+                    break;
+                }
+
+                const long j = this->position[c];
+                const unsigned d = this->at(j + dir);
+                if (c == b || d == a || this->is_fixed(c, d)) {
+                    continue;
+                }
+
+                const int32_t delta = ac + this->costs(b, d) - ab - this->costs(c, d);
+                if (delta < 0) {
+                    const size_t n = this->order();
+                    if (dir > 0) {
+                        this->reverse((i + 1) % n, j);
+                    } else {
+                        this->reverse(j, (i + n - 1) % n);
+                    }
+                    return std::array { a, b, c, d };
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+public:
+    [[gnu::hot]]
+    inline two_opt(
+        const utils::cost_table& costs,
+        const std::vector<unsigned>& candidates,
+        size_t width,
+        const utils::triangular<bool>& fixed,
+        tour& path
+    ):
+        costs(costs), candidates(candidates), width(width), fixed(fixed), path(path), position(path.size())
+    {
+        for (unsigned p = 0; p < path.size(); p++) {
+            this->position[path[p]] = p;
+        }
+    }
+
+    /** Applies improving moves until a local optimum, using don't-look bits. */
+    [[gnu::hot]]
+    void run() {
+        if (this->order() < 4) [[unlikely]] {
+            return;
+        }
+
+        auto active = std::vector<bool>(this->order(), true);
+        auto queue = std::vector<unsigned>(this->path.begin(), this->path.end());
+
+        while (!queue.empty()) {
+            const unsigned a = queue.back();
+            queue.pop_back();
+            active[a] = false;
+
+            if (auto touched = this->improve(a)) {
+                for (unsigned v : *touched) {
+                    if (!active[v]) {
+                        active[v] = true;
+                        queue.push_back(v);
+                    }
+                }
+            }
+        }
+    }
+};
+
+
+/** Or-opt over candidate neighbor lists: moves segments of up to three vertices, never removing fixed edges. */
+struct or_opt final {
+private:
+    static constexpr size_t max_segment = 3;
+
+    const utils::cost_table& costs;
+    const std::vector<unsigned>& candidates;
+    const size_t width;
+    const utils::triangular<bool>& fixed;
+
+    tour& path;
+    std::vector<unsigned> position;
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t order() const noexcept {
+        return this->path.size();
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t next(size_t p, size_t step = 1) const noexcept {
+        return (p + step) % this->order();
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t previous(size_t p) const noexcept {
+        return (p + this->order() - 1) % this->order();
+    }
+
+    /** Whether position `p` lies in the segment of `len` positions starting at `start`. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool inside(size_t p, size_t start, size_t len) const noexcept {
+        return (p + this->order() - start) % this->order() < len;
+    }
+
+    /** Moves the segment at `start` between the vertices at `after` and its successor, reversed if asked. */
+    [[gnu::hot]]
+    inline void move(size_t start, size_t len, size_t after, bool reversed) {
+        auto segment = std::vector<unsigned>();
+        for (size_t s = 0; s < len; s++) {
+            segment.push_back(this->path[this->next(start, s)]);
+        }
+        if (reversed) {
+            std::reverse(segment.begin(), segment.end());
+        }
+        const unsigned anchor = this->path[after];
+
+        auto moved = tour();
+        moved.reserve(this->order());
+        for (size_t s = 0; s < this->order(); s++) {
+            const size_t p = this->next(start, len + s);
+            if (this->inside(p, start, len)) {
+                continue;
+            }
+            moved.push_back(this->path[p]);
+            if (this->path[p] == anchor) {
+                moved.insert(moved.end(), segment.begin(), segment.end());
+            }
+        }
+
+        this->path = std::move(moved);
+        for (unsigned p = 0; p < this->order(); p++) {
+            this->position[this->path[p]] = p;
+        }
+    }
+
+    /** Applies the first improving move of a segment starting at position `start`. */
+    [[gnu::hot]]
+    inline bool improve(size_t start) {
+        for (size_t len = 1; len <= std::min(max_segment, this->order() - 3); len++) {
+            const size_t end = this->next(start, len - 1);
+            const unsigned p = this->path[this->previous(start)], first = this->path[start];
+            const unsigned last = this->path[end], n = this->path[this->next(end)];
+            if (this->fixed(p, first) || this->fixed(last, n)) {
+                continue;
+            }
+            const int32_t removed = this->costs(p, first) + this->costs(last, n) - this->costs(p, n);
+
+            for (unsigned endpoint : { first, last }) {
+                for (size_t r = 0; r < this->width; r++) {
+                    const unsigned c = this->candidates[endpoint * this->width + r];
+                    const size_t at = this->position[c];
+                    if (this->inside(at, start, len)) {
+                        continue;
+                    }
+
+                    // insert between `c` and its successor, which cannot be the segment itself
+                    const size_t after = (this->next(at) == start) ? this->previous(at) : at;
+                    const unsigned a = this->path[after], b = this->path[this->next(after)];
+                    if (this->inside(this->next(after), start, len) || this->fixed(a, b)) {
+                        continue;
+                    }
+
+                    const int32_t forward = this->costs(a, first) + this->costs(last, b);
+                    const int32_t backward = this->costs(a, last) + this->costs(first, b);
+                    const int32_t added = std::min(forward, backward) - this->costs(a, b);
+                    if (added < removed) {
+                        this->move(start, len, after, backward < forward);
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+public:
+    [[gnu::hot]]
+    inline or_opt(
+        const utils::cost_table& costs,
+        const std::vector<unsigned>& candidates,
+        size_t width,
+        const utils::triangular<bool>& fixed,
+        tour& path
+    ):
+        costs(costs), candidates(candidates), width(width), fixed(fixed), path(path), position(path.size())
+    {
+        for (unsigned p = 0; p < path.size(); p++) {
+            this->position[path[p]] = p;
+        }
+    }
+
+    /** Applies improving moves until none is left, returning whether the tour changed. */
+    [[gnu::hot]]
+    bool run() {
+        if (this->order() < 5) [[unlikely]] {
+            return false;
+        }
+
+        bool changed = false, improved = true;
+        while (improved) {
+            improved = false;
+            for (size_t start = 0; start < this->order(); start++) {
+                improved |= this->improve(start);
+            }
+            changed |= improved;
+        }
+        return changed;
+    }
+};
+
+
+/**
+ * Lagrangian heuristic: repairs a relaxed solution into two Hamiltonian cycles sharing at least `k` edges.
+ *
+ * Shared edges are fixed first, preferring edges used by both 1-trees and then edges picked by the
+ * relaxed `z`. Each tour is then completed greedily from its own 1-tree and cost order, and improved
+ * with 2-opt without touching the shared edges.
+ */
+struct lagrangian_heuristic final {
+private:
+    static constexpr size_t width = 10;
+
+    const ::costs& costs;
+    const size_t n;
+    const unsigned k;
+
+    /** Costs of both layers summed, paid by shared edges. */
+    const utils::cost_table summed;
+
+    /** Edges sorted by cost, per layer and for both layers summed. */
+    utils::pair<std::vector<utils::edge>> sorted;
+    std::vector<utils::edge> sorted_shared;
+    /** Nearest `width` vertices of each vertex, per layer and for both layers summed. */
+    std::array<std::vector<unsigned>, 3> candidates;
+
+    utils::triangular<bool> fixed;
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline int32_t shared_cost(unsigned u, unsigned v) const noexcept {
+        return this->summed(u, v);
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline const utils::cost_table& layer(uint8_t i) const noexcept {
+        return (i <= 1) ? this->costs[i] : this->summed;
+    }
+
+    [[gnu::cold]]
+    inline void sort_edges() {
+        auto all = std::vector<utils::edge>();
+        all.reserve((this->n * (this->n - 1)) / 2);
+        for (unsigned v = 0; v < this->n; v++) {
+            for (unsigned u = 0; u < v; u++) {
+                all.emplace_back(u, v);
+            }
+        }
+
+        for (uint8_t i = 0; i <= 1; i++) {
+            this->sorted[i] = all;
+            std::stable_sort(this->sorted[i].begin(), this->sorted[i].end(), [this, i](auto e, auto f) {
+                return this->costs(i, e.first, e.second) < this->costs(i, f.first, f.second);
+            });
+        }
+        this->sorted_shared = std::move(all);
+        std::stable_sort(this->sorted_shared.begin(), this->sorted_shared.end(), [this](auto e, auto f) {
+            return this->shared_cost(e.first, e.second) < this->shared_cost(f.first, f.second);
+        });
+    }
+
+    [[gnu::cold]]
+    inline void nearest_candidates() {
+        const size_t w = std::min(width, this->n - 1);
+        for (uint8_t i = 0; i < this->candidates.size(); i++) {
+            const auto& costs = this->layer(i);
+            this->candidates[i].resize(this->n * width);
+            auto others = std::vector<unsigned>();
+
+            for (unsigned u = 0; u < this->n; u++) {
+                others.clear();
+                for (unsigned v = 0; v < this->n; v++) {
+                    if (v != u) {
+                        others.push_back(v);
+                    }
+                }
+                std::partial_sort(others.begin(), others.begin() + w, others.end(), [&costs, u](unsigned a, unsigned b) {
+                    return costs(u, a) < costs(u, b);
+                });
+                for (size_t r = 0; r < width; r++) {
+                    this->candidates[i][u * width + r] = others[std::min(r, w - 1)];
+                }
+            }
+        }
+    }
+
+    /**
+     * Picks at least `min(k, n-1)` edges forming disjoint paths to be shared by both tours.
+     *
+     * Edges in `preferred` are tried first, by priority and then by summed cost, and the cheapest
+     * remaining edges fill the rest.
+     */
+    [[gnu::hot]]
+    inline utils::path_builder shared_paths(std::vector<std::pair<int, utils::edge>> preferred) const {
+        const size_t target = std::min<size_t>(this->k, this->n - 1);
+        auto paths = utils::path_builder(this->n);
+        if (target <= 0) {
+            return paths;
+        }
+
+        std::sort(preferred.begin(), preferred.end(), [this](const auto& a, const auto& b) {
+            const auto ca = this->shared_cost(a.second.first, a.second.second);
+            const auto cb = this->shared_cost(b.second.first, b.second.second);
+            return a.first < b.first || (a.first == b.first && ca < cb);
+        });
+
+        for (const auto& [priority, edge] : preferred) {
+            if (paths.size() >= target) {
+                return paths;
+            }
+            paths.add(edge.first, edge.second);
+        }
+        for (auto [u, v] : this->sorted_shared) {
+            if (paths.size() >= target) {
+                return paths;
+            }
+            paths.add(u, v);
+        }
+        return paths;
+    }
+
+    /** Shared paths preferring edges used by both 1-trees and then edges picked by the relaxed `z`. */
+    [[gnu::hot]]
+    inline utils::path_builder shared_paths(const utils::pair<one_tree>& trees, const std::vector<size_t>& shared) const {
+        auto preferred = std::vector<std::pair<int, utils::edge>>();
+        preferred.reserve(trees[0].edges.size() + shared.size());
+        auto in_first = utils::triangular<bool>(this->n);
+        for (auto [u, v] : trees[0].edges) {
+            in_first.set(u, v);
+        }
+        for (auto [u, v] : trees[1].edges) {
+            if (in_first(u, v)) {
+                preferred.emplace_back(0, utils::edge(u, v));
+            }
+        }
+        for (size_t e : shared) {
+            preferred.emplace_back(1, utils::triangular_edge(e));
+        }
+        return this->shared_paths(std::move(preferred));
+    }
+
+    /** Shared paths preferring edges already in both tours and then edges in either of them. */
+    [[gnu::hot]]
+    inline utils::path_builder shared_paths(const utils::pair<tour>& tours) const {
+        auto preferred = std::vector<std::pair<int, utils::edge>>();
+        auto in_first = utils::triangular<bool>(this->n);
+        for (auto [u, v] : edges_of(tours[0])) {
+            in_first.set(u, v);
+        }
+        for (auto [u, v] : edges_of(tours[1])) {
+            preferred.emplace_back(in_first(u, v) ? 0 : 1, utils::edge(u, v));
+        }
+        for (auto [u, v] : edges_of(tours[0])) {
+            preferred.emplace_back(1, utils::edge(u, v));
+        }
+        return this->shared_paths(std::move(preferred));
+    }
+
+    [[gnu::hot]]
+    static std::vector<utils::edge> edges_of(const tour& path) {
+        auto edges = std::vector<utils::edge>();
+        edges.reserve(path.size());
+        for (size_t p = 0; p < path.size(); p++) {
+            edges.emplace_back(path[p], path[(p + 1) % path.size()]);
+        }
+        return edges;
+    }
+
+    /** Edges sorted by cost on layer `i`, or by summed cost when `i` is 2. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline const std::vector<utils::edge>& sorted_edges(uint8_t i) const noexcept {
+        return (i <= 1) ? this->sorted[i] : this->sorted_shared;
+    }
+
+    /** Alternates 2-opt and Or-opt on layer `i` (summed costs if 2) until neither improves. */
+    [[gnu::hot]]
+    inline void local_search(uint8_t i, tour& path) const {
+        do {
+            two_opt(this->layer(i), this->candidates[i], width, this->fixed, path).run();
+        } while (or_opt(this->layer(i), this->candidates[i], width, this->fixed, path).run());
+    }
+
+    /** Closes `paths` into a tour for layer `i`, trying the `preferred` edges before all others. */
+    [[gnu::hot]]
+    inline tour complete(uint8_t i, utils::path_builder paths, std::vector<utils::edge> preferred) const {
+        std::sort(preferred.begin(), preferred.end(), [this, i](auto e, auto f) {
+            return this->costs(i, e.first, e.second) < this->costs(i, f.first, f.second);
+        });
+
+        paths.extend(preferred);
+        paths.extend(this->sorted[i]);
+        return paths.walk();
+    }
+
+    /** Marks the edges of `paths` as fixed, or releases them. */
+    [[gnu::hot]]
+    inline void mark(const utils::path_builder& paths, bool value) {
+        for (unsigned u = 0; u < this->n; u++) {
+            for (unsigned v : paths.adjacent(u)) {
+                this->fixed.set(u, v, value);
+            }
+        }
+    }
+
+    [[gnu::pure]] [[gnu::hot]]
+    inline bool feasible(const utils::pair<tour>& tours) const {
+        if (tours[0].size() != this->n || tours[1].size() != this->n) [[unlikely]] {
+            return false;
+        }
+        return similarity(tours[0], tours[1]) >= std::min<size_t>(this->k, this->n);
+    }
+
+public:
+    [[gnu::cold]]
+    lagrangian_heuristic(const ::costs& costs, size_t order, unsigned k):
+        costs(costs), n(order), k(k), summed(costs[0], costs[1]), fixed(order)
+    {
+        this->sort_edges();
+        this->nearest_candidates();
+    }
+
+    /** Number of edges present in both tours. */
+    [[gnu::pure]] [[gnu::hot]]
+    static unsigned similarity(const tour& first, const tour& second) {
+        auto present = std::vector<bool>();
+        for (unsigned p = 0; p < first.size(); p++) {
+            const size_t e = utils::triangular_index(first[p], first[(p + 1) % first.size()]);
+            if (e >= present.size()) {
+                present.resize(e + 1, false);
+            }
+            present[e] = true;
+        }
+
+        unsigned total = 0;
+        for (unsigned p = 0; p < second.size(); p++) {
+            const size_t e = utils::triangular_index(second[p], second[(p + 1) % second.size()]);
+            total += e < present.size() && present[e];
+        }
+        return total;
+    }
+
+    /** Builds a feasible tour pair from the relaxed solution, if the repair succeeds. */
+    [[gnu::hot]]
+    std::optional<utils::pair<tour>> repair(const utils::pair<one_tree>& trees, const std::vector<size_t>& shared) {
+        const auto paths = this->shared_paths(trees, shared);
+        if (this->k >= this->n) {
+            // both tours are the same, so optimize it for the summed costs
+            auto path = paths.walk();
+            two_opt(this->summed, this->candidates[2], width, this->fixed, path).run();
+            return utils::pair<tour>{ path, path };
+        }
+
+        this->mark(paths, true);
+        auto tours = utils::pair<tour>{ this->complete(0, paths, trees[0].edges), this->complete(1, paths, trees[1].edges) };
+        for (uint8_t i = 0; i <= 1; i++) {
+            two_opt(this->costs[i], this->candidates[i], width, this->fixed, tours[i]).run();
+        }
+        this->mark(paths, false);
+
+        if (!this->feasible(tours)) [[unlikely]] {
+            return std::nullopt;
+        }
+        return tours;
+    }
+
+    /**
+     * Patches the support of a fractional solution into a feasible tour pair.
+     *
+     * The `shared` edges and then the edges in both supports are fixed as shared paths, each tour
+     * is completed from its own `support` before the cheapest edges, and both are improved with
+     * 2-opt and Or-opt around the shared paths.
+     */
+    [[gnu::hot]]
+    std::optional<utils::pair<tour>> patch(const utils::pair<std::vector<utils::edge>>& support, const std::vector<utils::edge>& shared) {
+        auto preferred = std::vector<std::pair<int, utils::edge>>();
+        preferred.reserve(shared.size() + support[1].size());
+        for (auto edge : shared) {
+            preferred.emplace_back(0, edge);
+        }
+        auto in_first = utils::triangular<bool>(this->n);
+        for (auto [u, v] : support[0]) {
+            in_first.set(u, v);
+        }
+        for (auto [u, v] : support[1]) {
+            if (in_first(u, v)) {
+                preferred.emplace_back(1, utils::edge(u, v));
+            }
+        }
+
+        const auto paths = this->shared_paths(std::move(preferred));
+        if (this->k >= this->n) {
+            auto path = paths.walk();
+            this->local_search(2, path);
+            return utils::pair<tour>{ path, path };
+        }
+
+        this->mark(paths, true);
+        auto tours = utils::pair<tour>{ this->complete(0, paths, support[0]), this->complete(1, paths, support[1]) };
+        for (uint8_t i = 0; i <= 1; i++) {
+            this->local_search(i, tours[i]);
+        }
+        this->mark(paths, false);
+
+        if (!this->feasible(tours)) [[unlikely]] {
+            return std::nullopt;
+        }
+        return tours;
+    }
+
+    /**
+     * Builds a feasible tour pair from scratch, e.g. as a start for an exact solver.
+     *
+     * Each tour is built by greedy edge matching on its own layer and improved with 2-opt and
+     * Or-opt. If they share fewer than `k` edges, the shared paths are taken either from the edges
+     * of both tours or from a tour on the summed costs, both tours are rebuilt around them, and
+     * the cheapest repair is kept.
+     */
+    [[gnu::cold]]
+    std::optional<utils::pair<tour>> construct() {
+        const auto greedy = [this](uint8_t i) {
+            auto paths = utils::path_builder(this->n);
+            paths.extend(this->sorted_edges(i));
+            auto path = paths.walk();
+            this->local_search(i, path);
+            return path;
+        };
+        const auto total = [this](const utils::pair<tour>& tours) {
+            return tour::cost(this->costs, 0, tours[0]) + tour::cost(this->costs, 1, tours[1]);
+        };
+
+        const auto summed = greedy(2);
+        if (this->k >= this->n) {
+            return utils::pair<tour>{ summed, summed };
+        }
+
+        const auto layers = utils::pair<tour>{ greedy(0), greedy(1) };
+        if (this->feasible(layers)) [[unlikely]] {
+            return layers;
+        }
+
+        auto best = std::optional<utils::pair<tour>>();
+        for (const auto& source : { layers, utils::pair<tour>{ summed, summed } }) {
+            const auto paths = this->shared_paths(source);
+            auto tours = layers;
+
+            this->mark(paths, true);
+            for (uint8_t i = 0; i <= 1; i++) {
+                tours[i] = this->complete(i, paths, edges_of(layers[i]));
+                this->local_search(i, tours[i]);
+            }
+            this->mark(paths, false);
+
+            if (this->feasible(tours) && (!best || total(tours) < total(*best))) {
+                best = std::move(tours);
+            }
+        }
+        return best;
+    }
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "vertex.hpp"
+
+
+namespace utils {
+    /** Read-only memory mapping of a whole file, unmapped on destruction. */
+    struct mapped_file final {
+    private:
+        const char *bytes = nullptr;
+        size_t len = 0;
+
+    public:
+        [[gnu::cold]]
+        explicit mapped_file(const std::string& filename) {
+            const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) [[unlikely]] {
+                throw invalid_file::is_empty_or_missing(filename);
+            }
+
+            struct stat info;
+            if (::fstat(fd, &info) != 0 || info.st_size <= 0) [[unlikely]] {
+                ::close(fd);
+                throw invalid_file::is_empty_or_missing(filename);
+            }
+            this->len = size_t(info.st_size);
+
+            void *addr = ::mmap(nullptr, this->len, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (addr == MAP_FAILED) [[unlikely]] {
+                throw invalid_file::is_empty_or_missing(filename);
+            }
+            // pages are consumed front to back and only once
+            ::madvise(addr, this->len, MADV_SEQUENTIAL);
+            this->bytes = static_cast<const char *>(addr);
+        }
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        [[gnu::cold]]
+        ~mapped_file() {
+            if (this->bytes != nullptr) [[likely]] {
+                ::munmap(const_cast<char *>(this->bytes), this->len);
+            }
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline std::string_view view() const noexcept {
+            return std::string_view(this->bytes, this->len);
+        }
+    };
+
+    /**
+     * Reads up to `limit` vertices from a coordinate file with one `x1 y1 x2 y2` line per vertex.
+     *
+     * Numbers are parsed straight from the mapped pages, and reading stops after `limit` vertices,
+     * so only the needed prefix of a large file is ever touched.
+     */
+    [[gnu::cold]]
+    static std::vector<vertex> load_vertices(
+        const std::string& filename,
+        size_t limit = std::numeric_limits<size_t>::max()
+    ) {
+        const auto file = mapped_file(filename);
+        const auto text = file.view();
+        const char *cursor = text.data(), *const end = text.data() + text.size();
+
+        const auto skip = [&cursor, end](bool newlines) {
+            while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || (newlines && *cursor == '\n'))) {
+                cursor++;
+            }
+        };
+
+        auto vertices = std::vector<vertex>();
+        while (vertices.size() < limit) {
+            skip(true);
+            if (cursor >= end) {
+                break;
+            }
+
+            double coords[4];
+            for (double& coord : coords) {
+                skip(false);
+                const auto [next, error] = std::from_chars(cursor, end, coord);
+                if (error != std::errc()) [[unlikely]] {
+                    throw invalid_file::contains_invalid_data(filename);
+                }
+                cursor = next;
+            }
+
+            skip(false);
+            if (cursor < end && *cursor != '\n') [[unlikely]] {
+                throw invalid_file::contains_invalid_data(filename);
+            }
+            vertices.emplace_back(coords[0], coords[1], coords[2], coords[3]);
+        }
+
+        if (vertices.empty()) [[unlikely]] {
+            throw invalid_file::is_empty_or_missing(filename);
+        }
+        return vertices;
+    }
+}
@@ -0,0 +1,478 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "vertex.hpp"
+#include "costs.hpp"
+#include "tour.hpp"
+#include "one_tree.hpp"
+#include "heuristic.hpp"
+#include "stop.hpp"
+
+
+struct subgradient_options final {
+    /** Maximum number of subgradient iterations. */
+    unsigned max_iterations = 10000;
+    /** Initial step size multiplier. */
+    double step = 2.0;
+    /** Iterations without improving the lower bound before halving the step. */
+    unsigned patience = 150;
+    /** Stop once the step multiplier drops below this. */
+    double min_step = 1e-5;
+    /** Wall clock limit, in seconds. */
+    std::optional<double> time_limit = std::nullopt;
+    /** Iterations between repairs of the relaxed solution into a primal bound. */
+    unsigned repair_interval = 1;
+};
+
+
+/** Edges forced into or kept out of each tour, e.g. at a node of `branch_and_bound`. */
+struct edge_fixing final {
+    /** Weight added to or removed from fixed edges, larger than any pair of tours. */
+    static constexpr double penalty = 1e7;
+
+private:
+    /** One for included edges and minus one for excluded ones, in `triangular_index` order. */
+    utils::pair<std::vector<int8_t>> state;
+    utils::pair<size_t> included = { 0, 0 };
+
+public:
+    /** No edge fixed. */
+    inline edge_fixing() noexcept = default;
+
+    [[gnu::cold]]
+    explicit edge_fixing(size_t order):
+        state({ std::vector<int8_t>(utils::triangular_size(order), 0), std::vector<int8_t>(utils::triangular_size(order), 0) })
+    { }
+
+    [[gnu::hot]] [[gnu::nothrow]]
+    inline void fix(uint8_t i, unsigned u, unsigned v, bool include) noexcept {
+        auto& cell = this->state[i][utils::triangular_index(u, v)];
+        if (cell > 0) {
+            this->included[i] -= 1;
+        }
+        if (include) {
+            this->included[i] += 1;
+        }
+        cell = include ? 1 : -1;
+    }
+
+    /** One if edge `e` is forced into tour `i`, minus one if kept out, zero if free. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline int8_t operator()(uint8_t i, size_t e) const noexcept {
+        return this->state[i].empty() ? 0 : this->state[i][e];
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool is_free(uint8_t i, unsigned u, unsigned v) const noexcept {
+        return (*this)(i, utils::triangular_index(u, v)) == 0;
+    }
+
+    /** Number of edges forced into tour `i`. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t included_in(uint8_t i) const noexcept {
+        return this->included[i];
+    }
+};
+
+/** Multipliers of the relaxed coupling and degree constraints. */
+struct lagrangian_multipliers final {
+    utils::pair<std::vector<double>> lambda;
+    utils::pair<std::vector<double>> pi;
+};
+
+
+/**
+ * Lagrangian dual of the kSTSP, solved by subgradient optimization.
+ *
+ * The coupling constraints `x^i_e >= z_e` are relaxed with multipliers `lambda^i_e >= 0` and the
+ * degree constraints with free penalties `pi^i_v`. Each tour subproblem becomes a minimum 1-tree and
+ * the shared-edge subproblem reduces to picking the `k` edges with least `lambda^1_e + lambda^2_e`.
+ * Every relaxed solution is repaired by `lagrangian_heuristic` into a primal bound.
+ */
+struct lagrangian final {
+private:
+    static constexpr double epsilon = 1e-6;
+
+    const ::costs& costs;
+    const size_t n;
+    const unsigned k;
+    subgradient_options options;
+    edge_fixing fixing;
+
+    utils::pair<std::vector<double>> lambda;
+    utils::pair<std::vector<double>> pi;
+    /** Multipliers of the best dual bound so far. */
+    utils::pair<std::vector<double>> best_lambda;
+    utils::pair<std::vector<double>> best_pi;
+    utils::pair<one_tree> trees;
+    std::vector<size_t> shared;
+
+    std::vector<size_t> edge_order;
+    std::vector<bool> is_shared;
+    std::vector<bool> in_tree;
+
+    double step;
+    unsigned stale = 0;
+    uint64_t iteration = 0;
+    double current = -std::numeric_limits<double>::infinity();
+    double best_lower = -std::numeric_limits<double>::infinity();
+    double best_upper = std::numeric_limits<double>::infinity();
+    utils::pair<::tour> best_tours;
+    lagrangian_heuristic heuristic;
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t edges() const noexcept {
+        return (this->n * (this->n - 1)) / 2;
+    }
+
+    /**
+     * Checked before anything is sized by `order`, since the 1-trees need at least 3 vertices, and
+     * tours of `order` vertices cannot share more than `order` edges.
+     */
+    [[gnu::cold]]
+    static size_t checked_order(size_t order, unsigned k) {
+        if (order < 3) [[unlikely]] {
+            throw std::invalid_argument("The lagrangian relaxation needs at least 3 vertices, got " + std::to_string(order) + ".");
+        } else if (k > order) [[unlikely]] {
+            throw std::invalid_argument("Tours on " + std::to_string(order) + " vertices cannot share " + std::to_string(k) + " edges.");
+        }
+        return order;
+    }
+
+    /** Cost of edge `(u, v)` on layer `i` after applying the multipliers `lambda` and `pi` and the fixing. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double weight(uint8_t i, unsigned u, unsigned v, const std::vector<double>& lambda, const std::vector<double>& pi) const noexcept {
+        const size_t e = utils::triangular_index(u, v);
+        return this->costs(i, u, v) - lambda[e] + pi[u] + pi[v] - edge_fixing::penalty * this->fixing(i, e);
+    }
+
+    /** Cost of edge `(u, v)` on layer `i` after applying the current multipliers. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double reduced_cost(uint8_t i, unsigned u, unsigned v) const noexcept {
+        return this->weight(i, u, v, this->lambda[i], this->pi[i]);
+    }
+
+    /** Cost of sharing edge `e`, which is only allowed where neither tour excludes it. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double shared_cost(size_t e) const noexcept {
+        const bool excluded = this->fixing(0, e) < 0 || this->fixing(1, e) < 0;
+        return this->lambda[0][e] + this->lambda[1][e] + (excluded ? edge_fixing::penalty : 0.0);
+    }
+
+    [[gnu::hot]]
+    inline void solve_tours() {
+        for (uint8_t i = 0; i <= 1; i++) {
+            this->trees[i] = one_tree::minimum(this->n, [this, i](unsigned u, unsigned v) {
+                return this->reduced_cost(i, u, v);
+            });
+        }
+    }
+
+    [[gnu::hot]]
+    inline void solve_shared() {
+        const size_t k = std::min<size_t>(this->k, this->edges());
+        for (size_t e : this->shared) {
+            this->is_shared[e] = false;
+        }
+
+        const auto cost = [this](size_t e) {
+            return this->shared_cost(e);
+        };
+        std::nth_element(this->edge_order.begin(), this->edge_order.begin() + k, this->edge_order.end(),
+            [&cost](size_t e, size_t f) { return cost(e) < cost(f); });
+
+        this->shared.assign(this->edge_order.begin(), this->edge_order.begin() + k);
+        for (size_t e : this->shared) {
+            this->is_shared[e] = true;
+        }
+    }
+
+    [[gnu::pure]] [[gnu::hot]]
+    inline double dual_value() const noexcept {
+        double value = 0.0;
+        for (uint8_t i = 0; i <= 1; i++) {
+            value += this->trees[i].cost + edge_fixing::penalty * this->fixing.included_in(i);
+            value -= 2 * std::accumulate(this->pi[i].begin(), this->pi[i].end(), 0.0);
+        }
+        for (size_t e : this->shared) {
+            value += this->shared_cost(e);
+        }
+        return value;
+    }
+
+    /** Squared norm of the subgradient at the current relaxed solution. */
+    [[gnu::pure]] [[gnu::hot]]
+    inline double subgradient_norm() const noexcept {
+        double norm = 0.0;
+        for (uint8_t i = 0; i <= 1; i++) {
+            for (int degree : this->trees[i].degree) {
+                norm += (degree - 2) * (degree - 2);
+            }
+
+            size_t overlap = 0;
+            for (auto [u, v] : this->trees[i].edges) {
+                overlap += this->is_shared[utils::triangular_index(u, v)];
+            }
+            norm += this->shared.size() + this->trees[i].edges.size() - 2 * overlap;
+        }
+        return norm;
+    }
+
+    [[gnu::hot]]
+    inline void update_multipliers(double t) {
+        for (uint8_t i = 0; i <= 1; i++) {
+            for (unsigned v = 0; v < this->n; v++) {
+                this->pi[i][v] += t * (this->trees[i].degree[v] - 2);
+            }
+
+            for (auto [u, v] : this->trees[i].edges) {
+                this->in_tree[utils::triangular_index(u, v)] = true;
+            }
+            for (size_t e : this->shared) {
+                if (!this->in_tree[e]) {
+                    this->lambda[i][e] += t;
+                }
+            }
+            for (auto [u, v] : this->trees[i].edges) {
+                const size_t e = utils::triangular_index(u, v);
+                if (!this->is_shared[e]) {
+                    this->lambda[i][e] = std::max(0.0, this->lambda[i][e] - t);
+                }
+                this->in_tree[e] = false;
+            }
+        }
+    }
+
+    [[gnu::cold]]
+    inline void initial_upper_bound() {
+        const auto path = tour::nearest_neighbour(this->n, [this](unsigned u, unsigned v) {
+            return this->costs(0, u, v) + this->costs(1, u, v);
+        });
+        this->best_tours = { path, path };
+        this->best_upper = tour::cost(this->costs, 0, path) + tour::cost(this->costs, 1, path);
+    }
+
+    [[gnu::hot]]
+    inline void improve_upper_bound() {
+        if (auto tours = this->heuristic.repair(this->trees, this->shared)) {
+            const double cost = tour::cost(this->costs, 0, (*tours)[0]) + tour::cost(this->costs, 1, (*tours)[1]);
+            if (cost < this->best_upper) {
+                this->best_upper = cost;
+                this->best_tours = std::move(*tours);
+            }
+        }
+    }
+
+    [[gnu::pure]] [[gnu::hot]]
+    inline bool finished() const noexcept {
+        if (this->iteration >= this->options.max_iterations || this->step < this->options.min_step) [[unlikely]] {
+            return true;
+        }
+        if (this->lower_bound() >= this->upper_bound() || utils::should_stop()) [[unlikely]] {
+            return true;
+        }
+        return this->timed_out();
+    }
+
+    [[gnu::pure]] [[gnu::hot]]
+    inline bool timed_out() const noexcept {
+        if (auto limit = this->options.time_limit) [[likely]] {
+            return this->elapsed() >= *limit;
+        }
+        return false;
+    }
+
+    /** Runs one subgradient iteration, returning false when the subgradient vanishes. */
+    [[gnu::hot]]
+    inline bool iterate() {
+        this->solve_tours();
+        this->solve_shared();
+        if (this->iteration % std::max(1U, this->options.repair_interval) == 0) {
+            this->improve_upper_bound();
+        }
+        this->iteration += 1;
+
+        this->current = this->dual_value();
+        if (this->current > this->best_lower + epsilon) {
+            this->best_lower = this->current;
+            this->best_lambda = this->lambda;
+            this->best_pi = this->pi;
+            this->stale = 0;
+        } else if (++this->stale >= this->options.patience) {
+            this->step /= 2;
+            this->stale = 0;
+        }
+
+        const double norm = this->subgradient_norm();
+        if (norm <= 0.0) [[unlikely]] {
+            return false;
+        }
+
+        const double t = this->step * (this->best_upper - this->current) / norm;
+        this->update_multipliers(t);
+        return true;
+    }
+
+public:
+    [[gnu::cold]]
+    lagrangian(const ::costs& costs, size_t order, unsigned k, subgradient_options options = {}):
+        costs(costs), n(checked_order(order, k)), k(k), options(options),
+        lambda({ std::vector<double>(this->edges(), 0.0), std::vector<double>(this->edges(), 0.0) }),
+        pi({ std::vector<double>(order, 0.0), std::vector<double>(order, 0.0) }),
+        best_lambda(lambda), best_pi(pi),
+        edge_order(this->edges()), is_shared(this->edges(), false), in_tree(this->edges(), false),
+        step(options.step), heuristic(costs, order, k)
+    {
+        std::iota(this->edge_order.begin(), this->edge_order.end(), 0);
+        this->initial_upper_bound();
+    }
+
+    using clock = std::chrono::high_resolution_clock;
+    const clock::time_point start = clock::now();
+
+    [[gnu::cold]] [[gnu::nothrow]]
+    inline double elapsed() const noexcept {
+        auto end = clock::now();
+        std::chrono::duration<double> secs = end - this->start;
+        return secs.count();
+    }
+
+    /** Number of vertices. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline size_t order() const noexcept {
+        return this->n;
+    }
+
+    [[gnu::hot]]
+    double solve() {
+        while (!this->finished() && this->iterate()) [[likely]] { }
+        return this->elapsed();
+    }
+
+    /**
+     * Prepares another `solve` restricted by `fixing`, starting from the multipliers `start`.
+     *
+     * The best primal solution is kept, since it is feasible whatever the fixing, while the dual
+     * bound and the iteration count start over.
+     */
+    [[gnu::hot]]
+    void restart(edge_fixing fixing, const lagrangian_multipliers& start, subgradient_options options) {
+        this->fixing = std::move(fixing);
+        this->options = options;
+        this->lambda = this->best_lambda = start.lambda;
+        this->pi = this->best_pi = start.pi;
+        this->step = options.step;
+        this->stale = 0;
+        this->iteration = 0;
+        this->current = -std::numeric_limits<double>::infinity();
+        this->best_lower = -std::numeric_limits<double>::infinity();
+    }
+
+    /** Replaces the primal bound by `tours`, if they are cheaper. */
+    [[gnu::hot]]
+    void incumbent(const utils::pair<::tour>& tours) {
+        const double cost = tour::cost(this->costs, 0, tours[0]) + tour::cost(this->costs, 1, tours[1]);
+        if (cost < this->best_upper) {
+            this->best_upper = cost;
+            this->best_tours = tours;
+        }
+    }
+
+    /** Multipliers of the best dual bound. */
+    [[gnu::pure]] [[gnu::cold]]
+    lagrangian_multipliers multipliers() const {
+        return { this->best_lambda, this->best_pi };
+    }
+
+    /** Minimum 1-trees of both tours at the multipliers of the best dual bound. */
+    [[gnu::hot]]
+    utils::pair<one_tree> best_trees() const {
+        const auto tree = [this](uint8_t i) {
+            return one_tree::minimum(this->n, [this, i](unsigned u, unsigned v) {
+                return this->weight(i, u, v, this->best_lambda[i], this->best_pi[i]);
+            });
+        };
+        return { tree(0), tree(1) };
+    }
+
+    /** Why the last `solve` stopped. */
+    [[gnu::pure]] [[gnu::cold]]
+    std::string_view status() const {
+        if (this->lower_bound() >= this->upper_bound()) {
+            return "optimal";
+        } else if (utils::should_stop()) {
+            return "interrupted";
+        } else if (this->timed_out()) {
+            return "time_limit";
+        }
+        return "finished";
+    }
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline uint64_t iterations() const noexcept {
+        return this->iteration;
+    }
+
+    /** Best dual bound, rounded up since every cost is integral. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double lower_bound() const noexcept {
+        return std::ceil(this->best_lower - epsilon);
+    }
+
+    /** Best dual value, without rounding. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline double dual_bound() const noexcept {
+        return this->best_lower;
+    }
+
+    /**
+     * Reduced costs of the 1-tree of each tour at the multipliers of `dual_bound`.
+     *
+     * Forcing edge `e` into tour `i` raises that subproblem by at least `reduced[i](e)` and leaves
+     * the others as they are, so every solution using `e` in tour `i` costs at least
+     * `dual_bound() + reduced[i](e)`.
+     */
+    [[gnu::cold]]
+    utils::pair<utils::triangular<double>> reduced_costs() const {
+        const auto reduced = [this](uint8_t i) {
+            const auto weight = [this, i](unsigned u, unsigned v) {
+                return this->weight(i, u, v, this->best_lambda[i], this->best_pi[i]);
+            };
+            return one_tree::minimum(this->n, weight).reduced_costs(weight);
+        };
+        return { reduced(0), reduced(1) };
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double upper_bound() const noexcept {
+        return this->best_upper;
+    }
+
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline double gap() const noexcept {
+        return (this->upper_bound() - this->lower_bound()) / this->upper_bound();
+    }
+
+    /** Tours of the best primal solution found. */
+    [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+    inline const ::tour& tour(uint8_t i) const noexcept {
+        return this->best_tours[i];
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    int64_t tour_cost(uint8_t i) const {
+        return tour::cost(this->costs, i, this->tour(i));
+    }
+};
@@ -1,28 +1,51 @@
+#include <algorithm>
+#include <array>
 #include <chrono>
-#include <csignal>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
 #include <optional>
 #include <span>
 #include <stdexcept>
-#include <unistd.h>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <variant>
 #include <vector>
 
 #include "graph.hpp"
+#ifndef NO_GUROBI
+#include "gurobi.hpp"
+#endif
+#include "mock.hpp"
+#include "lagrangian.hpp"
+#include "pricing.hpp"
+#include "branch.hpp"
+#include "instance.hpp"
+#include "report.hpp"
+#include "stop.hpp"
 #include "coordinates.hpp"
 #include "argparse.hpp"
 
 
 namespace utils {
-    [[gnu::cold]]
-    static GRBEnv quiet_env() {
-        auto env = GRBEnv(true);
-        env.set(GRB_IntParam_OutputFlag, 0);
-        env.set(GRB_IntParam_LazyConstraints, 1);
-        env.start();
-        return env;
-    }
+    struct experiment final {
+        unsigned nodes;
+        unsigned k;
+    };
+
+    /** Instances of the reference experiment: |V| in {100, 150, 200, 250} and k in {0, |V|/2, |V|}. */
+    static constexpr std::array<experiment, 12> experiment_grid = {
+        experiment { 100, 0 }, experiment { 100,  50 }, experiment { 100, 100 },
+        experiment { 150, 0 }, experiment { 150,  75 }, experiment { 150, 150 },
+        experiment { 200, 0 }, experiment { 200, 100 }, experiment { 200, 200 },
+        experiment { 250, 0 }, experiment { 250, 125 }, experiment { 250, 250 },
+    };
 }
 
+
 struct program final {
 private:
     argparse::ArgumentParser args;
@@ -34,13 +57,16 @@ private:
             .default_value<unsigned>(100)
             .scan<'u', unsigned>();
 
+        this->args.add_argument("--instance")
+            .help("coordinate file with 'x1 y1 x2 y2' per line (compiled-in instance if not given)");
+
         this->args.add_argument("-k", "--similarity")
             .help("minimun number of shared edges between tours")
             .default_value<unsigned>(0)
             .scan<'u', unsigned>();
 
         this->args.add_argument("--timeout")
-            .help("execution timeout (in minutes), disabled if zero or negative")
+            .help("time limit per solve (in minutes), reporting the best bounds when reached; disabled if zero or negative")
             .default_value<double>(30.0)
             .scan<'g', double>();
 
@@ -48,6 +74,109 @@ private:
             .help("show vertices present on each solution")
             .default_value(false)
             .implicit_value(true);
+
+        this->args.add_argument("--threads")
+            .help("threads for the solver, split between tours when k is zero (all cores if zero, shared between the jobs of --grid)")
+            .default_value<unsigned>(0)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--strengthen")
+            .help("mark as shared every edge used by both tours, on top of linking shared edges to both tours")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--cold-start")
+            .help("skip the heuristic tours given to the solver as a starting solution")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--sparse")
+            .help("solve on the nearest neighbour edges first, pricing in missing edges until the tours are optimal for the complete graph")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--neighbours")
+            .help("nearest neighbours of each vertex on each cost layer given to the sparse model")
+            .default_value<unsigned>(10)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--eliminate")
+            .help("fix to zero before building the model every edge whose lagrangian reduced cost exceeds the gap to the heuristic tours")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--max-cuts")
+            .help("maximum lazy subtour cuts per tour on each integer solution")
+            .default_value<unsigned>(32)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--cut-nodes")
+            .help("separate fractional subtours on the first nodes of the search tree, disabled if zero")
+            .default_value<double>(500)
+            .scan<'g', double>();
+
+        this->args.add_argument("--inject-nodes")
+            .help("nodes between attempts to patch a nearly integral relaxation into an incumbent, disabled if zero")
+            .default_value<double>(50)
+            .scan<'g', double>();
+
+        this->args.add_argument("--inject-budget")
+            .help("share of the solve time that patching relaxations into incumbents may take")
+            .default_value<double>(0.05)
+            .scan<'g', double>();
+
+        this->args.add_argument("--trace")
+            .help("write the solve timeline (root relaxation, incumbents and bound samples) as CSV to this file");
+
+        this->args.add_argument("--sample-interval")
+            .help("seconds between bound samples in the timeline, disabled if zero")
+            .default_value<double>(1.0)
+            .scan<'g', double>();
+
+        this->args.add_argument("--record")
+            .help("record every callback and result of the solver to this file, for replaying with --replay");
+
+        this->args.add_argument("--replay")
+            .help("replay the solves recorded in this file instead of running Gurobi, to time building the model and the callback without a licence");
+
+        this->args.add_argument("--format")
+            .help("output format: 'text', 'csv' or 'json' (one record per run)")
+            .default_value<std::string>("text");
+
+        this->args.add_argument("--grid")
+            .help("run every instance of the experiment grid, writing one results row per instance")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--jobs")
+            .help("instances solved at the same time with --grid (cores over threads per solve if zero)")
+            .default_value<unsigned>(0)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("-l", "--lagrangian")
+            .help("solve the lagrangian dual with the subgradient method instead of the full model")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("-b", "--branch")
+            .help("solve with the built-in branch and bound on lagrangian bounds instead of Gurobi")
+            .default_value(false)
+            .implicit_value(true);
+
+        this->args.add_argument("--max-iter")
+            .help("maximum number of subgradient iterations")
+            .default_value<unsigned>(10000)
+            .scan<'u', unsigned>();
+
+        this->args.add_argument("--step")
+            .help("initial step size multiplier for the subgradient method")
+            .default_value<double>(2.0)
+            .scan<'g', double>();
+
+        this->args.add_argument("--patience")
+            .help("subgradient iterations without improvement before halving the step")
+            .default_value<unsigned>(150)
+            .scan<'u', unsigned>();
     }
 
 public:
@@ -55,21 +184,56 @@ public:
     explicit program(const std::vector<std::string>& arguments): program(arguments[0]) {
         try {
             this->args.parse_args(arguments);
+            this->format();
+            if (this->grid() && (this->record() || this->replay())) [[unlikely]] {
+                throw std::invalid_argument("--record and --replay only apply to a single run, not to --grid");
+            }
+            if (!this->grid() && this->nodes() < 3) [[unlikely]] {
+                throw std::invalid_argument("--nodes must be at least 3, the smallest graph with a tour");
+            }
+            if (!this->grid() && this->similarity() > this->nodes()) [[unlikely]] {
+                throw std::invalid_argument("--similarity must be at most --nodes, since tours on n vertices share at most n edges");
+            }
 
-        } catch (const std::runtime_error& err) {
+        } catch (const std::exception& err) {
             std::cerr << err.what() << std::endl;
             std::cerr << this->args << std::endl;
             std::exit(EXIT_FAILURE);
         }
-    }
 
-    const GRBEnv env = utils::quiet_env();
+        if (auto filename = this->instance()) [[unlikely]] {
+            try {
+                this->loaded = utils::load_vertices(*filename, this->order());
+
+            } catch (const utils::invalid_file& err) {
+                std::cerr << err.what() << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        if (this->record()) [[unlikely]] {
+            this->recording = std::make_shared<backend::shared_transcript>();
+        }
+    }
 
     [[gnu::pure]] [[gnu::cold]]
     inline unsigned nodes() const {
         return this->args.get<unsigned>("nodes");
     }
 
+    [[gnu::pure]] [[gnu::cold]]
+    inline std::optional<std::string> instance() const {
+        return this->args.present("instance");
+    }
+
+    /** Vertices needed by this run: the largest grid instance, or just `--nodes`. */
+    [[gnu::pure]] [[gnu::cold]]
+    inline unsigned order() const {
+        if (this->grid()) [[unlikely]] {
+            return std::ranges::max(utils::experiment_grid, {}, &utils::experiment::nodes).nodes;
+        }
+        return this->nodes();
+    }
+
     [[gnu::pure]] [[gnu::cold]]
     inline unsigned similarity() const {
         return this->args.get<unsigned>("similarity");
@@ -90,78 +254,679 @@ public:
         return this->args.get<bool>("tour");
     }
 
+    [[gnu::pure]] [[gnu::cold]]
+    inline unsigned threads() const {
+        return this->args.get<unsigned>("threads");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool strengthen() const {
+        return this->args.get<bool>("strengthen");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool warm_start() const {
+        return !this->args.get<bool>("cold-start");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool sparse() const {
+        return this->args.get<bool>("sparse");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline unsigned neighbours() const {
+        return this->args.get<unsigned>("neighbours");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool eliminate() const {
+        return this->args.get<bool>("eliminate");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline subtour_options separation() const {
+        auto options = subtour_options();
+        options.max_lazy_cuts = this->args.get<unsigned>("max-cuts");
+        options.fractional_nodes = this->args.get<double>("cut-nodes");
+        options.sample_interval = this->args.get<double>("sample-interval");
+        options.injection_interval = this->args.get<double>("inject-nodes");
+        options.injection_budget = this->args.get<double>("inject-budget");
+        return options;
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline std::optional<std::string> trace() const {
+        return this->args.present("trace");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline std::optional<std::string> record() const {
+        return this->args.present("record");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline std::optional<std::string> replay() const {
+        return this->args.present("replay");
+    }
+
+    /** Parsed `--format`, throwing on unknown names, so it is checked right after parsing. */
+    [[gnu::cold]]
+    inline utils::output_format format() const {
+        return utils::parse_output_format(this->args.get<std::string>("format"));
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool grid() const {
+        return this->args.get<bool>("grid");
+    }
+
+    /** Number of grid instances solved concurrently, never more than there are instances. */
+    [[gnu::pure]] [[gnu::cold]]
+    inline unsigned jobs() const {
+        auto jobs = this->args.get<unsigned>("jobs");
+        if (jobs <= 0) [[likely]] {
+            const unsigned cores = std::max(1U, std::thread::hardware_concurrency());
+            jobs = std::max(1U, cores / std::max(1U, this->threads()));
+        }
+        return std::min<unsigned>(jobs, utils::experiment_grid.size());
+    }
+
+    /**
+     * Threads of each solve: `--threads` if given, or else all cores for a single run and an even
+     * share of them for each job of `--grid`, so that concurrent solves do not oversubscribe.
+     */
+    [[gnu::pure]] [[gnu::cold]]
+    inline unsigned solver_threads() const {
+        if (this->threads() > 0 || !this->grid()) [[likely]] {
+            return this->threads();
+        }
+        const unsigned cores = std::max(1U, std::thread::hardware_concurrency());
+        return std::max(1U, cores / this->jobs());
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool lagrangian() const {
+        return this->args.get<bool>("lagrangian");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline bool branch() const {
+        return this->args.get<bool>("branch");
+    }
+
+    [[gnu::pure]] [[gnu::cold]]
+    inline subgradient_options subgradient() const {
+        auto options = subgradient_options();
+        options.max_iterations = this->args.get<unsigned>("max-iter");
+        options.step = this->args.get<double>("step");
+        options.patience = this->args.get<unsigned>("patience");
+        if (auto minutes = this->timeout()) [[likely]] {
+            options.time_limit = *minutes * 60;
+        }
+        return options;
+    }
+
+    /** The subgradient options bound the root, and the time limit the whole search. */
+    [[gnu::pure]] [[gnu::cold]]
+    inline branch_options branching() const {
+        auto options = branch_options();
+        options.root = this->subgradient();
+        options.time_limit = options.root.time_limit;
+        return options;
+    }
+
+    /** Name of the method used for each run. */
+    [[gnu::pure]] [[gnu::cold]]
+    inline std::string_view method() const {
+        if (this->lagrangian()) {
+            return "lagrangian";
+        } else if (this->branch()) {
+            return "branch";
+        }
+        return "model";
+    }
+
 private:
+    /** Vertices read with `--instance`, empty when using the compiled-in instance. */
+    std::vector<vertex> loaded;
+    /** Solves recorded for `--record`, written once the run ends. */
+    std::shared_ptr<backend::shared_transcript> recording;
+
+    /**
+     * Solver backend for the models of a run: the solves of `--replay` without any solver, or
+     * Gurobi with `threads` (all cores if zero), recorded for `--record` if given.
+     *
+     * Only built by the modes that solve a model, so the others need no licence. Builds with
+     * `NO_GUROBI` can only replay.
+     */
+    [[gnu::cold]]
+    std::unique_ptr<backend::environment> environment([[maybe_unused]] unsigned threads = 0) const {
+        if (auto filename = this->replay()) [[unlikely]] {
+            return std::make_unique<backend::mock_environment>(backend::transcript::read(*filename));
+        }
+#ifdef NO_GUROBI
+        throw std::invalid_argument("built without Gurobi, so models can only be solved with --replay");
+#else
+        auto env = std::make_unique<backend::gurobi_environment>(threads);
+        if (this->recording) [[unlikely]] {
+            return std::make_unique<backend::recording_environment>(std::move(env), this->recording);
+        }
+        return env;
+#endif
+    }
+
+    [[gnu::cold]]
+    inline std::span<const vertex> vertices(size_t count) const {
+        if (this->instance()) [[unlikely]] {
+            if (count > this->loaded.size()) [[unlikely]] {
+                throw utils::not_enough_items::in(this->loaded, count);
+            }
+            return std::span(this->loaded).first(count);
+        }
+        if (count > DEFAULT_VERTICES.size()) [[unlikely]] {
+            throw utils::not_enough_items::in(DEFAULT_VERTICES, count);
+        }
+        return std::span(DEFAULT_VERTICES).first(count);
+    }
+
     [[gnu::cold]]
     inline std::span<const vertex> vertices() const {
-        if (this->nodes() > DEFAULT_VERTICES.size()) [[unlikely]] {
-            throw utils::not_enough_items::in(DEFAULT_VERTICES, this->nodes());
+        return this->vertices(this->nodes());
+    }
+
+    /** Lagrangian reduced costs and the best heuristic tours, for deciding which edges the model needs. */
+    struct preprocessing final {
+        edge_pricing pricing;
+        /** Tours of the subgradient method and of the construction heuristic, cheapest first. */
+        std::vector<utils::pair<::tour>> tours;
+
+        [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+        inline const utils::pair<::tour>& best() const noexcept {
+            return this->tours.front();
         }
-        return std::span(DEFAULT_VERTICES).first(this->nodes());
+    };
+
+    [[gnu::cold]]
+    preprocessing preprocess(const costs& costs, unsigned nodes, unsigned k) const {
+        auto relaxation = ::lagrangian(costs, nodes, k, this->subgradient());
+        relaxation.solve();
+
+        auto tours = std::vector<utils::pair<::tour>> { { relaxation.tour(0), relaxation.tour(1) } };
+        if (auto constructed = lagrangian_heuristic(costs, nodes, k).construct()) [[likely]] {
+            tours.push_back(std::move(*constructed));
+        }
+        std::ranges::stable_sort(tours, {}, [&costs](const utils::pair<::tour>& pair) {
+            return tour::cost(costs, 0, pair[0]) + tour::cost(costs, 1, pair[1]);
+        });
+        return { edge_pricing(relaxation, k), std::move(tours) };
     }
 
+    /**
+     * Builds the model for the first `nodes` vertices, ready to be solved.
+     *
+     * With `--eliminate`, edges that cannot be in a solution cheaper than the heuristic tours get
+     * no variable at all, and the time spent finding them is taken from the limit of the solve, which
+     * stops right away if nothing is left.
+     */
     [[gnu::cold]]
-    graph map() const {
-        return graph(this->vertices(), this->env, this->similarity());
+    graph map(const costs& costs, unsigned nodes, unsigned k, const backend::environment& env) const {
+        const auto begin = std::chrono::steady_clock::now();
+        auto pre = std::optional<preprocessing>();
+        auto edges = std::optional<utils::pair<utils::edge_set>>();
+        if (this->eliminate()) [[unlikely]] {
+            pre.emplace(this->preprocess(costs, nodes, k));
+            const auto& best = pre->best();
+            edges = pre->pricing.reduce(best, tour::cost(costs, 0, best[0]) + tour::cost(costs, 1, best[1]));
+        }
+
+        auto g = graph(this->vertices(nodes), costs, env, k, this->strengthen(), this->solver_threads(), std::move(edges));
+        if (auto minutes = this->timeout()) [[likely]] {
+            const std::chrono::duration<double> spent = std::chrono::steady_clock::now() - begin;
+            g.time_limit(std::max(0.0, *minutes * 60 - spent.count()));
+        }
+        if (this->warm_start()) [[likely]] {
+            if (pre) [[unlikely]] {
+                g.warm_start(pre->best());
+            } else if (auto tours = lagrangian_heuristic(costs, nodes, k).construct()) [[likely]] {
+                g.warm_start(*tours);
+            }
+        }
+        return g;
     }
 
-public:
+    /** Last model solved by `solve_sparse`, with the bound proven for the complete graph. */
+    struct sparse_run final {
+        std::unique_ptr<graph> model;
+        /** Lower bound for the complete graph, below the one of the model while edges are missing. */
+        double lower = -std::numeric_limits<double>::infinity();
+        unsigned rounds = 0;
+        double solve_time = 0;
+    };
+
+    /**
+     * Solves the model on candidate edges only, then adds the missing edges that the lagrangian
+     * reduced costs cannot rule out and solves again, until none is left.
+     *
+     * The candidates are the nearest neighbours of each vertex plus the edges of the heuristic
+     * tours, and each round starts from the tours of the one before.
+     */
     [[gnu::hot]]
-    void run() const {
-        auto g = this->map();
-        std::cout << "Graph(n=" << g.order() << ",m=" << g.size() << ")" << std::endl;
+    sparse_run solve_sparse(const costs& costs, unsigned nodes, unsigned k, const backend::environment& env) const {
+        const auto begin = std::chrono::steady_clock::now();
+        const auto pre = this->preprocess(costs, nodes, k);
+        const auto candidates = utils::candidate_edges(costs, nodes, this->neighbours(), pre.tours);
+        auto edges = utils::pair<utils::edge_set> { candidates, candidates };
+        auto best = pre.best();
+
+        auto run = sparse_run();
+        while (true) {
+            run.model = std::make_unique<graph>(this->vertices(nodes), costs, env, k, this->strengthen(), this->solver_threads(), edges);
+            auto& g = *run.model;
+            if (auto minutes = this->timeout()) [[likely]] {
+                const std::chrono::duration<double> spent = std::chrono::steady_clock::now() - begin;
+                g.time_limit(std::max(0.0, *minutes * 60 - spent.count()));
+            }
+            if (this->warm_start()) [[likely]] {
+                g.warm_start(best);
+            }
+
+            run.solve_time += g.solve(this->separation());
+            run.rounds += 1;
+            run.lower = std::min(g.lower_bound(), pre.pricing.missing_bound(edges));
+            if (g.solution_count() <= 0 || g.stopped()) [[unlikely]] {
+                return run;
+            }
+
+            best = { g.tour(0), g.tour(1) };
+            if (pre.pricing.price(edges, g.solution_cost()) <= 0) {
+                return run;
+            }
+        }
+    }
+
+    [[gnu::cold]]
+    void show(const ::tour& tour) const {
+        auto vertices = std::vector<vertex>();
+        vertices.reserve(tour.size());
 
-        const auto elapsed = g.solve();
+        for (unsigned v : tour) {
+            vertices.push_back(this->vertices()[v]);
+        }
+        std::cout << utils::join(vertices, "\n") << std::endl;
+    }
+
+    [[gnu::cold]]
+    utils::run_report report(const graph& g, double solve_time) const {
+        auto report = utils::run_report { .method = "model", .nodes = unsigned(g.order()), .k = this->similarity() };
+        report.status = g.status_name();
+        report.lower = g.lower_bound();
+        report.root = g.root_lp();
+        report.search_nodes = g.node_count();
+        report.iterations = g.iterations();
+        report.callbacks = g.cuts().calls;
+        report.cuts = g.cuts().total();
+        report.build_time = g.build_time;
+        report.solve_time = solve_time;
+        if (g.solution_count() > 0) [[likely]] {
+            report.upper = g.solution_cost();
+            report.tour_1 = g.tour_cost(0);
+            report.tour_2 = g.tour_cost(1);
+            report.similarity = g.similarity();
+        }
+        return report;
+    }
+
+    [[gnu::cold]]
+    utils::run_report report(const ::lagrangian& relaxation, unsigned k, double build_time, double solve_time) const {
+        auto report = utils::run_report { .method = "lagrangian", .nodes = unsigned(relaxation.order()), .k = k };
+        report.status = relaxation.status();
+        report.lower = relaxation.lower_bound();
+        report.upper = relaxation.upper_bound();
+        report.iterations = relaxation.iterations();
+        report.build_time = build_time;
+        report.solve_time = solve_time;
+        report.tour_1 = relaxation.tour_cost(0);
+        report.tour_2 = relaxation.tour_cost(1);
+        report.similarity = lagrangian_heuristic::similarity(relaxation.tour(0), relaxation.tour(1));
+        return report;
+    }
+
+    [[gnu::cold]]
+    utils::run_report report(const branch_and_bound& search, unsigned k, double solve_time) const {
+        auto report = utils::run_report { .method = "branch", .nodes = unsigned(search.order()), .k = k };
+        report.status = search.status();
+        report.lower = search.lower_bound();
+        report.upper = search.upper_bound();
+        report.search_nodes = search.nodes();
+        report.iterations = search.iterations();
+        report.solve_time = solve_time;
+        report.tour_1 = search.tour_cost(0);
+        report.tour_2 = search.tour_cost(1);
+        report.similarity = lagrangian_heuristic::similarity(search.tour(0), search.tour(1));
+        return report;
+    }
+
+    /** Writes the timeline of `g` to `--trace`, with `suffix` appended to the file name. */
+    [[gnu::cold]]
+    void write_trace(const graph& g, const std::string& suffix = "") const {
+        const auto filename = this->trace();
+        if (!filename) [[likely]] {
+            return;
+        }
+
+        auto file = std::ofstream(*filename + suffix);
+        file << g.timeline();
+        if (!file) [[unlikely]] {
+            std::cerr << "Warning: could not write trace to \"" << *filename + suffix << "\"." << std::endl;
+        }
+    }
+
+    /** Writes the solves recorded for `--record`, if any. */
+    [[gnu::cold]]
+    void write_recording() const {
+        const auto filename = this->record();
+        if (!filename || !this->recording) [[likely]] {
+            return;
+        }
+
+        auto file = std::ofstream(*filename);
+        file << this->recording->recording;
+        if (!file) [[unlikely]] {
+            std::cerr << "Warning: could not write recording to \"" << *filename << "\"." << std::endl;
+        }
+    }
+
+    /** Column names, for the formats that have them. */
+    [[gnu::cold]]
+    void emit_header() const {
+        switch (this->format()) {
+            case utils::output_format::text:
+                std::cout << utils::run_report::header('\t') << std::endl;
+                break;
+            case utils::output_format::csv:
+                std::cout << utils::run_report::header(',') << std::endl;
+                break;
+            case utils::output_format::json:
+                break;
+        }
+    }
+
+    [[gnu::cold]]
+    void emit(const utils::run_report& report) const {
+        switch (this->format()) {
+            case utils::output_format::text:
+                report.write_row(std::cout, '\t');
+                break;
+            case utils::output_format::csv:
+                report.write_row(std::cout, ',');
+                break;
+            case utils::output_format::json:
+                report.write_json(std::cout);
+                break;
+        }
+        std::cout.flush();
+    }
+
+    /** Prints the results of a solve of `g`, with `lower` proven for the complete graph. */
+    [[gnu::cold]]
+    void show_results(const graph& g, double elapsed, double lower) const {
+        std::cout << "Status: " << g.status_name() << std::endl;
         std::cout << "Found " << g.solution_count() << " solution(s)."  << std::endl;
         std::cout << "Iterations: " << g.iterations() << std::endl;
+        std::cout << "Nodes: " << g.node_count() << std::endl;
+        if (auto relaxation = g.root_lp()) [[likely]] {
+            std::cout << "Root relaxation: " << *relaxation << std::endl;
+        }
+        if (auto bound = g.root_bound()) [[likely]] {
+            std::cout << "Root bound: " << *bound << std::endl;
+        }
+        std::cout << "Build time: " << g.build_time << " secs" << std::endl;
         std::cout << "Execution time: " << elapsed << " secs" << std::endl;
         std::cout << "Variables: " << g.var_count() << std::endl;
         std::cout << "Constraints: " << g.constr_count() << std::endl;
+        std::cout << "Subtour cuts: " << g.cuts().lazy << " lazy, " << g.cuts().user << " user" << std::endl;
+        std::cout << "Subtour forms: " << g.cuts().packing << " packing, " << g.cuts().cutset << " cutset" << std::endl;
+        std::cout << "Cut density: " << g.cuts().density() << " nonzeros per cut" << std::endl;
+        std::cout << "Callbacks: " << g.cuts().calls << std::endl;
+        std::cout << "Injected solutions: " << g.cuts().injected << std::endl;
+        std::cout << "Lower bound: " << lower << std::endl;
+        if (g.solution_count() <= 0) [[unlikely]] {
+            return;
+        }
+        std::cout << "Gap: " << 100 * (g.solution_cost() - lower) / g.solution_cost() << "%" << std::endl;
         std::cout << "Similarity: " << g.similarity() << std::endl;
         std::cout << "Objective cost: " << g.solution_cost() << std::endl;
 
         for (uint8_t i = 0; i <= 1; i++) {
-            const auto solution = g.solution(i);
-            std::cout << "Tour " << i+1 << ": total cost " << tour::cost(i, solution) << std::endl;
+            std::cout << "Tour " << i+1 << ": total cost " << g.tour_cost(i) << std::endl;
             if (this->tour()) [[unlikely]] {
-                std::cout << utils::join(solution, "\n") << std::endl;
+                std::cout << utils::join(g.solution(i), "\n") << std::endl;
             }
         }
     }
-};
 
-namespace timeout {
-    static auto start = std::chrono::steady_clock::now();
+    [[gnu::hot]]
+    void run_model(const costs& costs) const {
+        const auto env = this->environment();
+        auto g = this->map(costs, this->nodes(), this->similarity(), *env);
+        if (this->format() != utils::output_format::text) {
+            const auto elapsed = g.solve(this->separation());
+            this->write_trace(g);
+            this->emit_header();
+            return this->emit(this->report(g, elapsed));
+        }
+        std::cout << "Graph(n=" << g.order() << ",m=" << g.size() << ")" << std::endl;
+        if (g.is_sparse()) [[unlikely]] {
+            std::cout << "Candidate edges: " << g.edge_set(0).size() << ", " << g.edge_set(1).size() << std::endl;
+        }
 
-    [[gnu::cold]] [[gnu::nothrow]]
-    static void on_timeout(int signal) noexcept {
-        if (signal == SIGALRM) [[likely]] {
-            const auto end = std::chrono::steady_clock::now();
-            std::chrono::duration<double, std::ratio<60>> elapsed = end - start;
+        const auto elapsed = g.solve(this->separation());
+        this->write_trace(g);
+        this->show_results(g, elapsed, g.lower_bound());
+    }
 
-            std::cerr << "Timeout: stopping execution for taking too long." << std::endl;
-            std::cerr << "Instance has been running for " << elapsed.count() << " minutes." << std::endl;
-            std::exit(EXIT_FAILURE);
+    [[gnu::hot]]
+    void run_sparse(const costs& costs) const {
+        const auto env = this->environment();
+        const auto run = this->solve_sparse(costs, this->nodes(), this->similarity(), *env);
+        const auto& g = *run.model;
+        this->write_trace(g);
+
+        if (this->format() != utils::output_format::text) {
+            auto report = this->report(g, run.solve_time);
+            report.lower = run.lower;
+            this->emit_header();
+            return this->emit(report);
         }
+        std::cout << "Graph(n=" << g.order() << ",m=" << g.size() << ")" << std::endl;
+        std::cout << "Candidate edges: " << g.edge_set(0).size() << ", " << g.edge_set(1).size() << std::endl;
+        std::cout << "Pricing rounds: " << run.rounds << std::endl;
+        this->show_results(g, run.solve_time, run.lower);
     }
 
-    [[gnu::cold]] [[gnu::nothrow]]
-    static void setup(double minutes) {
+    [[gnu::hot]]
+    void run_lagrangian(const costs& costs) const {
+        const auto start = std::chrono::steady_clock::now();
+        auto relaxation = ::lagrangian(costs, this->nodes(), this->similarity(), this->subgradient());
+        const std::chrono::duration<double> build_time = std::chrono::steady_clock::now() - start;
+
+        if (this->format() != utils::output_format::text) {
+            const auto elapsed = relaxation.solve();
+            this->emit_header();
+            return this->emit(this->report(relaxation, this->similarity(), build_time.count(), elapsed));
+        }
+        std::cout << "Lagrangian(n=" << relaxation.order() << ",k=" << this->similarity() << ")" << std::endl;
+
+        const auto elapsed = relaxation.solve();
+        std::cout << "Status: " << relaxation.status() << std::endl;
+        std::cout << "Iterations: " << relaxation.iterations() << std::endl;
+        std::cout << "Build time: " << build_time.count() << " secs" << std::endl;
+        std::cout << "Execution time: " << elapsed << " secs" << std::endl;
+        std::cout << "Lower bound: " << relaxation.lower_bound() << std::endl;
+        std::cout << "Upper bound: " << relaxation.upper_bound() << std::endl;
+        std::cout << "Gap: " << 100 * relaxation.gap() << "%" << std::endl;
 
-        if (std::signal(SIGALRM, on_timeout) == SIG_ERR) [[unlikely]] {
-            std::cerr << "Warning: could not setup timeout for " << minutes << " minutes." << std::endl;
-            return;
+        for (uint8_t i = 0; i <= 1; i++) {
+            std::cout << "Tour " << i+1 << ": total cost " << relaxation.tour_cost(i) << std::endl;
+            if (this->tour()) [[unlikely]] {
+                this->show(relaxation.tour(i));
+            }
+        }
+    }
+
+    [[gnu::hot]]
+    void run_branch(const costs& costs) const {
+        auto search = branch_and_bound(costs, this->nodes(), this->similarity(), this->branching());
+        if (this->format() != utils::output_format::text) {
+            const auto elapsed = search.solve();
+            this->emit_header();
+            return this->emit(this->report(search, this->similarity(), elapsed));
         }
+        std::cout << "BranchAndBound(n=" << search.order() << ",k=" << this->similarity() << ")" << std::endl;
+
+        const auto elapsed = search.solve();
+        std::cout << "Status: " << search.status() << std::endl;
+        std::cout << "Nodes: " << search.nodes() << std::endl;
+        std::cout << "Iterations: " << search.iterations() << std::endl;
+        std::cout << "Execution time: " << elapsed << " secs" << std::endl;
+        std::cout << "Lower bound: " << search.lower_bound() << std::endl;
+        std::cout << "Upper bound: " << search.upper_bound() << std::endl;
+        std::cout << "Gap: " << 100 * search.gap() << "%" << std::endl;
 
-        alarm((unsigned) std::ceil(minutes * 60));
+        for (uint8_t i = 0; i <= 1; i++) {
+            std::cout << "Tour " << i+1 << ": total cost " << search.tour_cost(i) << std::endl;
+            if (this->tour()) [[unlikely]] {
+                this->show(search.tour(i));
+            }
+        }
     }
-}
 
+    /** Solves one grid instance, with `env` only needed by the methods that build a model. */
+    [[gnu::hot]]
+    utils::run_report solve_instance(const costs& costs, utils::experiment instance, const backend::environment *env) const {
+        const auto method = this->method();
+        try {
+            if (this->lagrangian()) {
+                const auto start = std::chrono::steady_clock::now();
+                auto relaxation = ::lagrangian(costs, instance.nodes, instance.k, this->subgradient());
+                const std::chrono::duration<double> build_time = std::chrono::steady_clock::now() - start;
+
+                const auto elapsed = relaxation.solve();
+                return this->report(relaxation, instance.k, build_time.count(), elapsed);
+            } else if (this->branch()) {
+                auto search = branch_and_bound(costs, instance.nodes, instance.k, this->branching());
+                const auto elapsed = search.solve();
+                return this->report(search, instance.k, elapsed);
+            } else if (this->sparse()) {
+                const auto run = this->solve_sparse(costs, instance.nodes, instance.k, *env);
+                this->write_trace(*run.model, "." + std::to_string(instance.nodes) + "-" + std::to_string(instance.k));
+                auto report = this->report(*run.model, run.solve_time);
+                report.k = instance.k;
+                report.lower = run.lower;
+                return report;
+            } else {
+                auto g = this->map(costs, instance.nodes, instance.k, *env);
+                const auto elapsed = g.solve(this->separation());
+                this->write_trace(g, "." + std::to_string(instance.nodes) + "-" + std::to_string(instance.k));
+                auto report = this->report(g, elapsed);
+                report.k = instance.k;
+                return report;
+            }
+        } catch (const std::exception& err) {
+            return utils::run_report { .method = method, .nodes = instance.nodes, .k = instance.k, .status = err.what() };
+#ifndef NO_GUROBI
+        } catch (const GRBException& err) {
+            return utils::run_report { .method = method, .nodes = instance.nodes, .k = instance.k, .status = err.getMessage() };
+#endif
+        }
+    }
+
+    /**
+     * Solves the whole experiment grid in this process.
+     *
+     * The cost tables are built once for the largest instance, since their layout is prefix-stable.
+     * Instances are handed to `jobs()` workers, largest first, and each worker reuses one
+     * environment for all of its solves. Gurobi environments are not thread safe, so workers do
+     * not share them, and only the modes that solve a model start one. Rows are written in grid
+     * order once every worker is done, whichever instance finished first.
+     */
+    [[gnu::hot]]
+    void run_grid() const {
+        const auto costs = ::costs(this->vertices(this->order()));
+
+        // positions in the grid, popped from the back so the largest instances start first
+        auto pending = std::vector<size_t>(utils::experiment_grid.size());
+        std::iota(pending.begin(), pending.end(), 0);
+        auto reports = std::vector<std::optional<utils::run_report>>(utils::experiment_grid.size());
+        auto lock = std::mutex();
+
+        const auto worker = [this, &costs, &pending, &reports, &lock](const backend::environment *env) {
+            while (true) {
+                auto guard = std::unique_lock(lock);
+                if (pending.empty() || utils::should_stop()) {
+                    return;
+                }
+                const size_t position = pending.back();
+                pending.pop_back();
+                guard.unlock();
+
+                auto report = this->solve_instance(costs, utils::experiment_grid[position], env);
+                guard.lock();
+                reports[position] = std::move(report);
+            }
+        };
+
+        const size_t jobs = this->jobs();
+        const bool solver = !this->lagrangian() && !this->branch();
+        auto envs = std::vector<std::unique_ptr<backend::environment>>();
+        for (size_t job = 0; job < jobs; job++) {
+            envs.push_back(solver ? this->environment(this->solver_threads()) : nullptr);
+        }
+
+        auto threads = std::vector<std::thread>();
+        for (size_t job = 1; job < jobs; job++) {
+            threads.emplace_back(worker, envs[job].get());
+        }
+        worker(envs.front().get());
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        this->emit_header();
+        for (const auto& report : reports) {
+            if (report) [[likely]] {
+                this->emit(*report);
+            }
+        }
+    }
+
+public:
+    [[gnu::hot]]
+    void run() const {
+        if (this->grid()) [[unlikely]] {
+            return this->run_grid();
+        }
+
+        const auto costs = ::costs(this->vertices());
+        if (this->lagrangian()) {
+            this->run_lagrangian(costs);
+        } else if (this->branch()) {
+            this->run_branch(costs);
+        } else if (this->sparse()) {
+            this->run_sparse(costs);
+        } else {
+            this->run_model(costs);
+        }
+        this->write_recording();
+    }
+};
 
 int main(int argc, const char * const argv[]) {
     const program program(std::vector<std::string>(argv, argv + argc));
 
-    if (auto minutes = program.timeout()) [[likely]] {
-        timeout::setup(*minutes);
+    if (!utils::stop_on_interrupt()) [[unlikely]] {
+        std::cerr << "Warning: could not handle interrupts, stopping will lose the current results." << std::endl;
     }
 
     try {
@@ -180,11 +945,12 @@ int main(int argc, const char * const argv[]) {
         std::cerr << "std::exception: " << err.what() << std::endl;
         return EXIT_FAILURE;
 
+#ifndef NO_GUROBI
     } catch (const GRBException& err) {
         std::cerr << "GRBException: code " << err.getErrorCode() << ", " << err.getMessage() << std::endl;
-        std::cerr << "GRBEnv::getErrorMsg: " << program.env.getErrorMsg() << std::endl;
         return EXIT_FAILURE;
 
+#endif
     } catch (...) {
         std::cerr << "unknown exception!" << std::endl;
         return EXIT_FAILURE;
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+
+namespace utils {
+    /** Dense symmetric edge weights of a fractional support graph. */
+    struct support_graph final {
+    private:
+        std::vector<double> weights;
+        size_t len;
+
+    public:
+        [[gnu::hot]]
+        explicit inline support_graph(size_t n): weights(n * n, 0.0), len(n) { }
+
+        /** Number of vertices. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline size_t size() const noexcept {
+            return this->len;
+        }
+
+        [[gnu::hot]] [[gnu::nothrow]]
+        inline void set(unsigned u, unsigned v, double weight) noexcept {
+            this->weights[u * this->size() + v] = weight;
+            this->weights[v * this->size() + u] = weight;
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline double operator()(unsigned u, unsigned v) const noexcept {
+            return this->weights[u * this->size() + v];
+        }
+
+        [[gnu::hot]] [[gnu::nothrow]]
+        inline void merge(unsigned into, unsigned from) noexcept {
+            for (unsigned v = 0; v < this->size(); v++) {
+                const double weight = (*this)(into, v) + (*this)(from, v);
+                this->set(into, v, weight);
+            }
+            this->set(into, into, 0.0);
+        }
+
+        /** Connected components over edges heavier than `epsilon`. */
+        [[gnu::hot]]
+        std::vector<std::vector<unsigned>> components(double epsilon) const {
+            auto seen = std::vector<bool>(this->size(), false);
+            auto components = std::vector<std::vector<unsigned>>();
+
+            for (unsigned root = 0; root < this->size(); root++) {
+                if (seen[root]) {
+                    continue;
+                }
+                seen[root] = true;
+                auto& component = components.emplace_back(1, root);
+
+                for (size_t idx = 0; idx < component.size(); idx++) {
+                    const unsigned u = component[idx];
+                    for (unsigned v = 0; v < this->size(); v++) {
+                        if (!seen[v] && (*this)(u, v) > epsilon) {
+                            seen[v] = true;
+                            component.push_back(v);
+                        }
+                    }
+                }
+            }
+            return components;
+        }
+
+        /**
+         * Vertex sets whose cut weighs less than `threshold`, taken from every phase of Stoer-Wagner.
+         *
+         * The global minimum cut is always among the phase cuts, so the result is empty only if no
+         * cut is lighter than `threshold`. Consumes the graph, since phases contract vertices.
+         */
+        [[gnu::hot]]
+        std::vector<std::vector<unsigned>> light_cuts(double threshold) && {
+            auto members = std::vector<std::vector<unsigned>>(this->size());
+            auto active = std::vector<unsigned>(this->size());
+            for (unsigned v = 0; v < this->size(); v++) {
+                members[v] = { v };
+                active[v] = v;
+            }
+
+            auto cuts = std::vector<std::vector<unsigned>>();
+            auto attached = std::vector<double>(this->size());
+            auto added = std::vector<bool>(this->size());
+
+            while (active.size() > 1) {
+                for (unsigned v : active) {
+                    attached[v] = 0.0;
+                    added[v] = false;
+                }
+
+                unsigned previous = active[0], last = active[0];
+                for (size_t step = 0; step < active.size(); step++) {
+                    double most = -std::numeric_limits<double>::infinity();
+                    for (unsigned v : active) {
+                        if (!added[v] && attached[v] > most) {
+                            most = attached[v];
+                            last = v;
+                        }
+                    }
+                    added[last] = true;
+
+                    if (step + 1 < active.size()) [[likely]] {
+                        previous = last;
+                        for (unsigned v : active) {
+                            if (!added[v]) {
+                                attached[v] += (*this)(last, v);
+                            }
+                        }
+                    }
+                }
+
+                if (attached[last] < threshold) {
+                    cuts.push_back(members[last]);
+                }
+
+                this->merge(previous, last);
+                members[previous].insert(members[previous].end(), members[last].begin(), members[last].end());
+                active.erase(std::find(active.begin(), active.end(), last));
+            }
+            return cuts;
+        }
+    };
+}
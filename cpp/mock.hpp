@@ -0,0 +1,656 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <span>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "vertex.hpp"
+#include "backend.hpp"
+
+
+namespace backend {
+    /** Nonzero values of some columns. */
+    using sparse_values = std::vector<std::pair<column, double>>;
+
+    static constexpr size_t attribute_count = size_t(attribute::bound) + 1;
+
+    /** One callback of a recorded solve, with what the callback asked for. */
+    struct recorded_event final {
+        event where = event::other;
+        std::array<double, info_count> infos = {
+            0.0, 0.0, std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(),
+        };
+        bool solved = true;
+        /** Integral solution or node relaxation, depending on `where`. */
+        sparse_values values;
+    };
+
+    /** Callbacks and final state of one solve, for the model created at the same position. */
+    struct recorded_solve final {
+        std::vector<recorded_event> events;
+        status result = status::unknown;
+        std::array<double, attribute_count> attributes = {};
+        /** Best solution found, if any. */
+        sparse_values values;
+    };
+
+    /**
+     * Callbacks and results of the solves of a run, one per model in creation order.
+     *
+     * Column numbers only depend on how the model was built, so a transcript recorded for an
+     * instance and options can be replayed by the same build without the solver that produced it.
+     * It is written as text, one line per event or result, with `inf` and `nan` spelled out.
+     */
+    struct transcript final {
+        std::deque<recorded_solve> solves;
+
+    private:
+        [[gnu::cold]]
+        static void write(std::ostream& os, const sparse_values& values) {
+            os << ' ' << values.size();
+            for (auto [var, value] : values) {
+                os << ' ' << var << ' ' << value;
+            }
+        }
+
+        /** Whitespace separated tokens of one line, read as numbers. */
+        struct tokens final {
+            std::istringstream line;
+
+            [[gnu::cold]]
+            double number() {
+                auto token = std::string();
+                if (!(this->line >> token)) [[unlikely]] {
+                    throw std::invalid_argument("missing field");
+                }
+                char *end = nullptr;
+                const double value = std::strtod(token.c_str(), &end);
+                if (*end != '\0') [[unlikely]] {
+                    throw std::invalid_argument("invalid number");
+                }
+                return value;
+            }
+
+            [[gnu::cold]]
+            sparse_values values() {
+                auto values = sparse_values(size_t(this->number()));
+                for (auto& [var, value] : values) {
+                    var = column(this->number());
+                    value = this->number();
+                }
+                return values;
+            }
+        };
+
+    public:
+        /** Reads a transcript written by `operator<<`. */
+        [[gnu::cold]]
+        static transcript read(const std::string& filename) {
+            auto file = std::ifstream(filename);
+            if (!file) [[unlikely]] {
+                throw utils::invalid_file::is_empty_or_missing(filename);
+            }
+
+            auto result = transcript();
+            auto line = std::string();
+            try {
+                while (std::getline(file, line)) {
+                    auto fields = tokens { std::istringstream(line) };
+                    auto kind = std::string();
+                    if (!(fields.line >> kind)) {
+                        continue;
+                    } else if (kind == "solve") {
+                        result.solves.emplace_back();
+                        continue;
+                    } else if (result.solves.empty()) [[unlikely]] {
+                        throw std::invalid_argument("record before any solve");
+                    }
+
+                    auto& solve = result.solves.back();
+                    if (kind == "event") {
+                        auto& event = solve.events.emplace_back();
+                        const auto where = unsigned(fields.number());
+                        if (where > unsigned(backend::event::other)) [[unlikely]] {
+                            throw std::invalid_argument("unknown event");
+                        }
+                        event.where = backend::event(where);
+                        for (auto& info : event.infos) {
+                            info = fields.number();
+                        }
+                        event.solved = fields.number() != 0;
+                        event.values = fields.values();
+                    } else if (kind == "result") {
+                        const auto code = unsigned(fields.number());
+                        if (code > unsigned(status::unknown)) [[unlikely]] {
+                            throw std::invalid_argument("unknown status");
+                        }
+                        solve.result = status(code);
+                        for (auto& attribute : solve.attributes) {
+                            attribute = fields.number();
+                        }
+                        solve.values = fields.values();
+                    } else {
+                        throw std::invalid_argument("unknown record");
+                    }
+                }
+            } catch (const std::invalid_argument&) {
+                throw utils::invalid_file::contains_invalid_data(filename);
+            }
+            return result;
+        }
+
+        [[gnu::cold]]
+        friend std::ostream& operator<<(std::ostream& os, const transcript& recording) {
+            os << std::setprecision(std::numeric_limits<double>::max_digits10);
+            for (const auto& solve : recording.solves) {
+                os << "solve\n";
+                for (const auto& event : solve.events) {
+                    os << "event " << unsigned(event.where);
+                    for (double info : event.infos) {
+                        os << ' ' << info;
+                    }
+                    os << ' ' << unsigned(event.solved);
+                    write(os, event.values);
+                    os << '\n';
+                }
+                os << "result " << unsigned(solve.result);
+                for (double attribute : solve.attributes) {
+                    os << ' ' << attribute;
+                }
+                write(os, solve.values);
+                os << '\n';
+            }
+            return os;
+        }
+    };
+
+    /** Transcript shared by every model of an environment and of its splits. */
+    struct shared_transcript final {
+        std::mutex lock;
+        transcript recording;
+
+        /** Slot for the next model created, which stays in place while others are added. */
+        [[gnu::cold]]
+        recorded_solve& next() {
+            const auto guard = std::lock_guard(this->lock);
+            return this->recording.solves.emplace_back();
+        }
+    };
+
+    /** Forwards to a solver context, recording every answer into an event. */
+    struct recording_context final : public context {
+    private:
+        context& inner;
+        recorded_event& record;
+
+        [[gnu::hot]]
+        inline void keep(std::span<const column> columns, std::span<const double> values) {
+            for (size_t j = 0; j < columns.size(); j++) {
+                if (values[j] != 0.0) {
+                    this->record.values.emplace_back(columns[j], values[j]);
+                }
+            }
+        }
+
+    public:
+        [[gnu::cold]]
+        recording_context(context& inner, recorded_event& record): inner(inner), record(record) {
+            this->record.where = inner.where();
+        }
+
+        [[gnu::hot]]
+        event where() const override {
+            return this->record.where;
+        }
+
+        [[gnu::hot]]
+        double get(info what) override {
+            return this->record.infos[size_t(what)] = this->inner.get(what);
+        }
+
+        [[gnu::hot]]
+        bool relaxation_solved() override {
+            return this->record.solved = this->inner.relaxation_solved();
+        }
+
+        [[gnu::hot]]
+        void solution(std::span<const column> columns, std::span<double> values) override {
+            this->inner.solution(columns, values);
+            this->keep(columns, values);
+        }
+
+        [[gnu::hot]]
+        void relaxation(std::span<const column> columns, std::span<double> values) override {
+            this->inner.relaxation(columns, values);
+            this->keep(columns, values);
+        }
+
+        [[gnu::hot]]
+        void add_lazy(const linear_expr& expr, sense sense, double rhs) override {
+            this->inner.add_lazy(expr, sense, rhs);
+        }
+
+        [[gnu::hot]]
+        void add_cut(const linear_expr& expr, sense sense, double rhs) override {
+            this->inner.add_cut(expr, sense, rhs);
+        }
+
+        [[gnu::hot]]
+        void set_solution(std::span<const column> columns, std::span<const double> values) override {
+            this->inner.set_solution(columns, values);
+        }
+
+        [[gnu::cold]]
+        void abort() override {
+            this->inner.abort();
+        }
+    };
+
+    /** Model that forwards to another one, recording its callbacks and results. */
+    struct recording_model final : public model {
+    private:
+        const std::unique_ptr<model> inner;
+        /** Owner of `record`, kept alive along with the model. */
+        const std::shared_ptr<shared_transcript> recording;
+        recorded_solve& record;
+        column columns = 0;
+
+        struct recorder final : public callback {
+            backend::callback& inner;
+            recorded_solve& record;
+
+            [[gnu::cold]]
+            recorder(backend::callback& inner, recorded_solve& record): inner(inner), record(record) { }
+
+            [[gnu::hot]]
+            void operator()(context& solver) override {
+                // polling and presolve calls carry nothing to replay
+                if (solver.where() == event::other) [[likely]] {
+                    return this->inner(solver);
+                }
+                auto recording = recording_context(solver, this->record.events.emplace_back());
+                this->inner(recording);
+            }
+        };
+
+    public:
+        [[gnu::cold]]
+        recording_model(std::unique_ptr<model> inner, std::shared_ptr<shared_transcript> recording):
+            inner(std::move(inner)), recording(std::move(recording)), record(this->recording->next())
+        { }
+
+        [[gnu::cold]]
+        column add_binaries(std::span<const double> objective, std::span<const std::string> names = {}) override {
+            this->columns += objective.size();
+            return this->inner->add_binaries(objective, names);
+        }
+
+        [[gnu::cold]]
+        void add_constrs(std::span<const linear_expr> exprs, sense sense, double rhs) override {
+            this->inner->add_constrs(exprs, sense, rhs);
+        }
+
+        [[gnu::cold]]
+        void update() override {
+            this->inner->update();
+        }
+
+        [[gnu::cold]]
+        void threads(unsigned count) override {
+            this->inner->threads(count);
+        }
+
+        [[gnu::cold]]
+        void time_limit(double seconds) override {
+            this->inner->time_limit(seconds);
+        }
+
+        [[gnu::cold]]
+        void start(std::span<const column> columns, std::span<const double> values) override {
+            this->inner->start(columns, values);
+        }
+
+        [[gnu::hot]]
+        void optimize(callback& callback) override {
+            auto wrapped = recorder(callback, this->record);
+            this->inner->optimize(wrapped);
+
+            this->record.result = this->inner->result();
+            const bool found = this->inner->get(attribute::solutions) > 0;
+            for (size_t a = 0; a < attribute_count; a++) {
+                // the objective only exists once a solution does
+                if (attribute(a) != attribute::objective || found) {
+                    this->record.attributes[a] = this->inner->get(attribute(a));
+                }
+            }
+
+            this->record.values.clear();
+            if (found) [[likely]] {
+                auto all = std::vector<column>(this->columns);
+                std::iota(all.begin(), all.end(), 0);
+                auto values = std::vector<double>(this->columns);
+                this->inner->solution(all, values);
+                for (column var = 0; var < this->columns; var++) {
+                    if (values[var] != 0.0) {
+                        this->record.values.emplace_back(var, values[var]);
+                    }
+                }
+            }
+        }
+
+        [[gnu::pure]] [[gnu::cold]]
+        status result() const override {
+            return this->inner->result();
+        }
+
+        [[gnu::pure]] [[gnu::cold]]
+        double get(attribute what) const override {
+            return this->inner->get(what);
+        }
+
+        [[gnu::cold]]
+        void solution(std::span<const column> columns, std::span<double> values) const override {
+            this->inner->solution(columns, values);
+        }
+    };
+
+    /** Records every solve of the models of `inner` into a transcript, for replaying with `mock_environment`. */
+    struct recording_environment final : public environment {
+    private:
+        const std::shared_ptr<const environment> inner;
+        const std::shared_ptr<shared_transcript> recording;
+
+    public:
+        [[gnu::cold]]
+        recording_environment(std::shared_ptr<const environment> inner, std::shared_ptr<shared_transcript> recording):
+            inner(std::move(inner)), recording(std::move(recording))
+        { }
+
+        [[gnu::cold]]
+        std::unique_ptr<model> make_model() const override {
+            return std::make_unique<recording_model>(this->inner->make_model(), this->recording);
+        }
+
+        [[gnu::cold]]
+        std::unique_ptr<environment> split(unsigned threads) const override {
+            return std::make_unique<recording_environment>(this->inner->split(threads), this->recording);
+        }
+    };
+
+
+    /** Row added to a mock model, as built by the caller. */
+    struct mock_row final {
+        linear_expr expr;
+        backend::sense sense;
+        double rhs;
+    };
+
+    /** Everything a model was asked to do, kept by `mock_environment` for inspection. */
+    struct mock_record final {
+        std::vector<double> objective;
+        std::vector<mock_row> rows;
+        std::vector<mock_row> lazy;
+        std::vector<mock_row> cuts;
+        /** Solutions proposed by the callback, dense over the columns. */
+        std::vector<std::vector<double>> proposed;
+        sparse_values start;
+        unsigned threads = 0;
+        double time_limit = std::numeric_limits<double>::infinity();
+        /** Callbacks made, including the ones cut short by an abort. */
+        size_t events = 0;
+    };
+
+    /** Script and records shared by a mock environment, its splits and all of their models. */
+    struct mock_state final {
+        std::mutex lock;
+        const transcript script;
+        std::deque<mock_record> records;
+
+        [[gnu::cold]]
+        explicit mock_state(transcript script): script(std::move(script)) { }
+    };
+
+    /** Context answering from a recorded event, recording what the callback adds. */
+    struct mock_context final : public context {
+    private:
+        const recorded_event& event;
+        /** Values of the event over every column, zero where not recorded. */
+        const std::vector<double>& values;
+        mock_record& record;
+
+        [[gnu::hot]]
+        inline void copy(std::span<const column> columns, std::span<double> values) const {
+            for (size_t j = 0; j < columns.size(); j++) {
+                values[j] = columns[j] < this->values.size() ? this->values[columns[j]] : 0.0;
+            }
+        }
+
+    public:
+        bool aborted = false;
+
+        [[gnu::cold]]
+        mock_context(const recorded_event& event, const std::vector<double>& values, mock_record& record):
+            event(event), values(values), record(record)
+        { }
+
+        [[gnu::hot]]
+        backend::event where() const override {
+            return this->event.where;
+        }
+
+        [[gnu::hot]]
+        double get(info what) override {
+            return this->event.infos[size_t(what)];
+        }
+
+        [[gnu::hot]]
+        bool relaxation_solved() override {
+            return this->event.solved;
+        }
+
+        [[gnu::hot]]
+        void solution(std::span<const column> columns, std::span<double> values) override {
+            this->copy(columns, values);
+        }
+
+        [[gnu::hot]]
+        void relaxation(std::span<const column> columns, std::span<double> values) override {
+            this->copy(columns, values);
+        }
+
+        [[gnu::hot]]
+        void add_lazy(const linear_expr& expr, sense sense, double rhs) override {
+            this->record.lazy.push_back({ expr, sense, rhs });
+        }
+
+        [[gnu::hot]]
+        void add_cut(const linear_expr& expr, sense sense, double rhs) override {
+            this->record.cuts.push_back({ expr, sense, rhs });
+        }
+
+        [[gnu::hot]]
+        void set_solution(std::span<const column> columns, std::span<const double> values) override {
+            auto& proposed = this->record.proposed.emplace_back(this->record.objective.size(), 0.0);
+            for (size_t j = 0; j < columns.size(); j++) {
+                proposed[columns[j]] = values[j];
+            }
+        }
+
+        [[gnu::cold]]
+        void abort() override {
+            this->aborted = true;
+        }
+    };
+
+    /**
+     * Model without a solver, replaying one solve of a transcript into the callback.
+     *
+     * Rows and cuts are only kept, never checked, so the replay follows the recorded solve as long
+     * as the model is built the same way. Without a recorded solve it ends with `status::unknown`
+     * and no solution.
+     */
+    struct mock_model final : public model {
+    private:
+        /** Owner of `script` and `record`, kept alive along with the model. */
+        const std::shared_ptr<mock_state> state;
+        const recorded_solve *script;
+        mock_record& record;
+        status outcome = status::unknown;
+
+        [[gnu::hot]]
+        inline std::vector<double> dense(const sparse_values& values) const {
+            auto result = std::vector<double>(this->record.objective.size(), 0.0);
+            for (auto [var, value] : values) {
+                if (var < result.size()) [[likely]] {
+                    result[var] = value;
+                }
+            }
+            return result;
+        }
+
+    public:
+        [[gnu::cold]]
+        mock_model(std::shared_ptr<mock_state> state, const recorded_solve *script, mock_record& record):
+            state(std::move(state)), script(script), record(record)
+        { }
+
+        [[gnu::cold]]
+        column add_binaries(std::span<const double> objective, std::span<const std::string> names = {}) override {
+            (void) names;
+            const column first = this->record.objective.size();
+            this->record.objective.insert(this->record.objective.end(), objective.begin(), objective.end());
+            return first;
+        }
+
+        [[gnu::cold]]
+        void add_constrs(std::span<const linear_expr> exprs, sense sense, double rhs) override {
+            for (const auto& expr : exprs) {
+                this->record.rows.push_back({ expr, sense, rhs });
+            }
+        }
+
+        [[gnu::cold]]
+        void update() override { }
+
+        [[gnu::cold]]
+        void threads(unsigned count) override {
+            this->record.threads = count;
+        }
+
+        [[gnu::cold]]
+        void time_limit(double seconds) override {
+            this->record.time_limit = seconds;
+        }
+
+        [[gnu::cold]]
+        void start(std::span<const column> columns, std::span<const double> values) override {
+            for (size_t j = 0; j < columns.size(); j++) {
+                if (values[j] != 0.0) {
+                    this->record.start.emplace_back(columns[j], values[j]);
+                }
+            }
+        }
+
+        [[gnu::hot]]
+        void optimize(callback& callback) override {
+            if (this->script == nullptr) [[unlikely]] {
+                this->outcome = status::unknown;
+                return;
+            }
+
+            this->outcome = this->script->result;
+            for (const auto& event : this->script->events) {
+                const auto values = this->dense(event.values);
+                auto solver = mock_context(event, values, this->record);
+                callback(solver);
+                this->record.events += 1;
+                if (solver.aborted) [[unlikely]] {
+                    this->outcome = status::interrupted;
+                    return;
+                }
+            }
+        }
+
+        [[gnu::pure]] [[gnu::cold]]
+        status result() const override {
+            return this->outcome;
+        }
+
+        [[gnu::pure]] [[gnu::cold]]
+        double get(attribute what) const override {
+            switch (what) {
+                case attribute::variables:
+                    return this->record.objective.size();
+                case attribute::constraints:
+                    return this->record.rows.size();
+                case attribute::quadratic_constraints:
+                    return 0;
+                default:
+                    return this->script != nullptr ? this->script->attributes[size_t(what)] : 0.0;
+            }
+        }
+
+        [[gnu::cold]]
+        void solution(std::span<const column> columns, std::span<double> values) const override {
+            const auto all = this->dense(this->script != nullptr ? this->script->values : sparse_values());
+            for (size_t j = 0; j < columns.size(); j++) {
+                values[j] = all[columns[j]];
+            }
+        }
+    };
+
+    /**
+     * Environment of mock models, which replay the solves of `script` in creation order.
+     *
+     * Models built from it and from its splits share one list of `mock_record`, so that the rows,
+     * cuts and solutions they were given can be checked once they are gone.
+     */
+    struct mock_environment final : public environment {
+    private:
+        const std::shared_ptr<mock_state> state;
+
+        [[gnu::cold]]
+        explicit mock_environment(std::shared_ptr<mock_state> state): state(std::move(state)) { }
+
+    public:
+        [[gnu::cold]]
+        explicit mock_environment(transcript script = {}):
+            state(std::make_shared<mock_state>(std::move(script)))
+        { }
+
+        [[gnu::cold]]
+        std::unique_ptr<model> make_model() const override {
+            const auto guard = std::lock_guard(this->state->lock);
+            const size_t position = this->state->records.size();
+            auto& record = this->state->records.emplace_back();
+
+            const auto& solves = this->state->script.solves;
+            const auto *script = position < solves.size() ? &solves[position] : nullptr;
+            return std::make_unique<mock_model>(this->state, script, record);
+        }
+
+        [[gnu::cold]]
+        std::unique_ptr<environment> split(unsigned threads) const override {
+            (void) threads;
+            return std::unique_ptr<environment>(new mock_environment(this->state));
+        }
+
+        /** What each model was given, in creation order. */
+        [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+        inline const std::deque<mock_record>& models() const noexcept {
+            return this->state->records;
+        }
+    };
+}
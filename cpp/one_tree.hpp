@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "triangular.hpp"
+
+
+/** Held-Karp 1-tree: a spanning tree over vertices `1..n-1` plus the two cheapest edges at vertex `0`. */
+struct one_tree final {
+public:
+    std::vector<std::pair<unsigned, unsigned>> edges;
+    std::vector<int> degree;
+    double cost = 0.0;
+
+private:
+    [[gnu::cold]]
+    explicit inline one_tree(size_t order): degree(order, 0) {
+        this->edges.reserve(order);
+    }
+
+    [[gnu::hot]]
+    inline void add(unsigned u, unsigned v, double weight) noexcept {
+        this->edges.emplace_back(u, v);
+        this->degree[u] += 1;
+        this->degree[v] += 1;
+        this->cost += weight;
+    }
+
+public:
+    inline one_tree() noexcept = default;
+
+    /**
+     * Minimum 1-tree under `weight`, using Prim's algorithm on the dense graph.
+     *
+     * Vertex `0` needs two other vertices to connect to, so smaller graphs get a tree without edges.
+     */
+    [[gnu::hot]]
+    static one_tree minimum(size_t order, std::invocable<unsigned, unsigned> auto&& weight) {
+        constexpr double inf = std::numeric_limits<double>::infinity();
+        auto tree = one_tree(order);
+        if (order < 3) [[unlikely]] {
+            return tree;
+        }
+
+        auto key = std::vector<double>(order, inf);
+        auto parent = std::vector<unsigned>(order, 1);
+        auto done = std::vector<bool>(order, false);
+        done[0] = true;
+        key[1] = 0.0;
+
+        for (size_t added = 1; added < order; added++) {
+            unsigned u = 1;
+            double best = inf;
+            for (unsigned v = 1; v < order; v++) {
+                if (!done[v] && key[v] < best) {
+                    best = key[v];
+                    u = v;
+                }
+            }
+
+            done[u] = true;
+            if (added > 1) [[likely]] {
+                tree.add(parent[u], u, key[u]);
+            }
+
+            for (unsigned v = 1; v < order; v++) {
+                if (!done[v]) [[likely]] {
+                    const double w = weight(u, v);
+                    if (w < key[v]) {
+                        key[v] = w;
+                        parent[v] = u;
+                    }
+                }
+            }
+        }
+
+        unsigned first = 1, second = 2;
+        if (weight(0, second) < weight(0, first)) {
+            std::swap(first, second);
+        }
+        for (unsigned v = 3; v < order; v++) {
+            const double w = weight(0, v);
+            if (w < weight(0, first)) {
+                second = first;
+                first = v;
+            } else if (w < weight(0, second)) {
+                second = v;
+            }
+        }
+        tree.add(0, first, weight(0, first));
+        tree.add(0, second, weight(0, second));
+        return tree;
+    }
+
+    /**
+     * Least increase of the cost of this tree when edge `(u, v)` is forced into it, for every edge.
+     *
+     * An edge away from vertex `0` replaces the heaviest edge on the tree path between its ends,
+     * and an edge at vertex `0` replaces the heavier of the two edges there, so tree edges cost
+     * nothing. Must be called with the `weight` the tree was built from.
+     */
+    [[gnu::hot]]
+    utils::triangular<double> reduced_costs(std::invocable<unsigned, unsigned> auto&& weight) const {
+        const size_t order = this->degree.size();
+        auto reduced = utils::triangular<double>(order, 0.0);
+        if (order < 3) [[unlikely]] {
+            return reduced;
+        }
+
+        auto adjacent = std::vector<std::vector<std::pair<unsigned, double>>>(order);
+        double heavier_at_0 = -std::numeric_limits<double>::infinity();
+        for (auto [u, v] : this->edges) {
+            const double w = weight(u, v);
+            if (u == 0 || v == 0) {
+                heavier_at_0 = std::max(heavier_at_0, w);
+            } else {
+                adjacent[u].emplace_back(v, w);
+                adjacent[v].emplace_back(u, w);
+            }
+        }
+        for (unsigned v = 1; v < order; v++) {
+            reduced(0, v) = std::max(0.0, weight(0, v) - heavier_at_0);
+        }
+
+        // heaviest edge on the path from `root` to each vertex, by a traversal of the spanning tree
+        auto heaviest = std::vector<double>(order);
+        auto stack = std::vector<std::pair<unsigned, unsigned>>();
+        for (unsigned root = 1; root < order; root++) {
+            heaviest[root] = -std::numeric_limits<double>::infinity();
+            stack.emplace_back(root, root);
+
+            while (!stack.empty()) {
+                const auto [u, from] = stack.back();
+                stack.pop_back();
+                if (u < root) {
+                    reduced(u, root) = std::max(0.0, weight(u, root) - heaviest[u]);
+                }
+                for (auto [v, w] : adjacent[u]) {
+                    if (v != from) {
+                        heaviest[v] = std::max(heaviest[u], w);
+                        stack.emplace_back(v, u);
+                    }
+                }
+            }
+        }
+        return reduced;
+    }
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace utils {
+    /**
+     * Persistent threads running small batches of tasks.
+     *
+     * Each call to `run` executes `task(0)` on the calling thread and `task(1)` up to
+     * `task(size() - 1)` on the workers, then waits for all of them. Threads are only spawned
+     * once, so batches can be dispatched from hot paths such as solver callbacks.
+     */
+    struct worker_pool final {
+    private:
+        std::vector<std::thread> threads;
+        std::vector<std::exception_ptr> errors;
+        std::function<void(size_t)> task;
+
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable done;
+        uint64_t generation = 0;
+        size_t pending = 0;
+        bool stopping = false;
+
+        [[gnu::hot]]
+        void work(size_t id) {
+            uint64_t seen = 0;
+            auto guard = std::unique_lock(this->lock);
+
+            while (true) {
+                this->wake.wait(guard, [this, seen] { return this->stopping || this->generation != seen; });
+                if (this->stopping) [[unlikely]] {
+                    return;
+                }
+                seen = this->generation;
+
+                guard.unlock();
+                try {
+                    this->task(id);
+                } catch (...) {
+                    this->errors[id] = std::current_exception();
+                }
+                guard.lock();
+
+                if (--this->pending <= 0) {
+                    this->done.notify_one();
+                }
+            }
+        }
+
+    public:
+        /** Pool running batches of `size` tasks, with `size - 1` worker threads. */
+        [[gnu::cold]]
+        explicit worker_pool(size_t size): errors(std::max<size_t>(size, 1)) {
+            for (size_t id = 1; id < size; id++) {
+                this->threads.emplace_back([this, id] { this->work(id); });
+            }
+        }
+
+        worker_pool(const worker_pool&) = delete;
+        worker_pool& operator=(const worker_pool&) = delete;
+
+        [[gnu::cold]]
+        ~worker_pool() {
+            {
+                auto guard = std::lock_guard(this->lock);
+                this->stopping = true;
+            }
+            this->wake.notify_all();
+            for (auto& thread : this->threads) {
+                thread.join();
+            }
+        }
+
+        /** Number of tasks in each batch, counting the calling thread. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline size_t size() const noexcept {
+            return this->threads.size() + 1;
+        }
+
+        /** Runs `task(id)` for every `id < size()` and rethrows the first failure, if any. */
+        [[gnu::hot]]
+        void run(std::function<void(size_t)> task) {
+            if (this->threads.empty()) [[unlikely]] {
+                task(0);
+                return;
+            }
+
+            {
+                auto guard = std::lock_guard(this->lock);
+                this->task = std::move(task);
+                std::fill(this->errors.begin(), this->errors.end(), nullptr);
+                this->pending = this->threads.size();
+                this->generation += 1;
+            }
+            this->wake.notify_all();
+
+            try {
+                this->task(0);
+            } catch (...) {
+                this->errors[0] = std::current_exception();
+            }
+
+            auto guard = std::unique_lock(this->lock);
+            this->done.wait(guard, [this] { return this->pending <= 0; });
+            for (const auto& error : this->errors) {
+                if (error) [[unlikely]] {
+                    std::rethrow_exception(error);
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "vertex.hpp"
+#include "costs.hpp"
+#include "tour.hpp"
+#include "edges.hpp"
+#include "lagrangian.hpp"
+
+
+namespace utils {
+    /**
+     * Sparse candidate edges: each vertex to its `width` nearest neighbours on either layer and on
+     * the summed costs, plus every edge of `tours`.
+     *
+     * Both tours get the same candidates, so that any edge available to one of them can be shared.
+     */
+    [[gnu::cold]]
+    static edge_set candidate_edges(const ::costs& costs, size_t order, unsigned width, std::span<const pair<tour>> tours) {
+        auto edges = edge_set(order);
+        const size_t w = std::min<size_t>(width, order - 1);
+        auto others = std::vector<unsigned>();
+
+        const auto summed = cost_table(costs[0], costs[1]);
+        for (const auto *layer : { &costs[0], &costs[1], &summed }) {
+            for (unsigned u = 0; u < order; u++) {
+                others.clear();
+                for (unsigned v = 0; v < order; v++) {
+                    if (v != u) [[likely]] {
+                        others.push_back(v);
+                    }
+                }
+                std::partial_sort(others.begin(), others.begin() + w, others.end(), [layer, u](unsigned a, unsigned b) {
+                    return (*layer)(u, a) < (*layer)(u, b);
+                });
+                for (size_t r = 0; r < w; r++) {
+                    edges.add(u, others[r]);
+                }
+            }
+        }
+
+        for (const auto& pair : tours) {
+            for (const auto& path : pair) {
+                for (size_t p = 0; p < path.size(); p++) {
+                    edges.add(path[p], path[(p + 1) % path.size()]);
+                }
+            }
+        }
+        return edges;
+    }
+}
+
+
+/**
+ * Pricing of the edges left out of a sparse model, by the reduced costs of the lagrangian 1-trees.
+ *
+ * Every solution using an edge costs at least its `bound`. Once the sparse model is solved, any
+ * missing edge whose bound is not below the optimum cannot improve it, so the optimum holds for the
+ * complete graph when no such edge is left. Costs are integral, so bounds are rounded up.
+ */
+struct edge_pricing final {
+private:
+    static constexpr double epsilon = 1e-6;
+
+    const double dual;
+    const utils::pair<utils::triangular<double>> reduced;
+    /** Whether both tours are the same, so an edge is forced into both at once. */
+    const bool identical;
+
+public:
+    [[gnu::cold]]
+    edge_pricing(const ::lagrangian& relaxation, unsigned k):
+        dual(relaxation.dual_bound()), reduced(relaxation.reduced_costs()), identical(k >= relaxation.order())
+    { }
+
+    /** Lower bound on any solution using edge `(u, v)` in tour `i`. */
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline double bound(uint8_t i, unsigned u, unsigned v) const noexcept {
+        if (this->identical) [[unlikely]] {
+            return std::ceil(this->dual + this->reduced[0](u, v) + this->reduced[1](u, v) - epsilon);
+        }
+        return std::ceil(this->dual + this->reduced[i](u, v) - epsilon);
+    }
+
+    /** Lower bound on any solution using some edge missing from `edges`, infinite if none is. */
+    [[gnu::pure]] [[gnu::cold]]
+    double missing_bound(const utils::pair<utils::edge_set>& edges) const {
+        double lowest = std::numeric_limits<double>::infinity();
+        for (uint8_t i = 0; i <= 1; i++) {
+            for (unsigned v = 0; v < edges[i].order(); v++) {
+                for (unsigned u = 0; u < v; u++) {
+                    if (!edges[i].contains(u, v)) {
+                        lowest = std::min(lowest, this->bound(i, u, v));
+                    }
+                }
+            }
+        }
+        return lowest;
+    }
+
+    /**
+     * Adds to `edges` every missing edge that could lead to a solution cheaper than `upper`.
+     *
+     * Returns the number of edges added, so zero means `upper` is optimal for the complete graph
+     * if it was optimal for `edges`.
+     */
+    [[gnu::cold]]
+    size_t price(utils::pair<utils::edge_set>& edges, double upper) const {
+        size_t added = 0;
+        for (uint8_t i = 0; i <= 1; i++) {
+            for (unsigned v = 0; v < edges[i].order(); v++) {
+                for (unsigned u = 0; u < v; u++) {
+                    if (this->bound(i, u, v) < upper - epsilon) {
+                        added += edges[i].add(u, v);
+                    }
+                }
+            }
+        }
+        return added;
+    }
+
+    /**
+     * Edges of each tour that may still lead to a solution cheaper than `upper`, the cost of `tours`.
+     *
+     * The edges of `tours` are always kept, so the model built on the result still has a solution
+     * as good as `upper` and every other edge can be fixed to zero beforehand.
+     */
+    [[gnu::cold]]
+    utils::pair<utils::edge_set> reduce(const utils::pair<tour>& tours, double upper) const {
+        const size_t order = this->reduced[0].size();
+        auto edges = utils::pair<utils::edge_set> { utils::edge_set(order), utils::edge_set(order) };
+        const auto keep = [&edges](uint8_t i, const tour& path) {
+            for (size_t p = 0; p < path.size(); p++) {
+                edges[i].add(path[p], path[(p + 1) % path.size()]);
+            }
+        };
+        keep(0, tours[0]);
+        keep(1, tours[1]);
+        if (this->identical) [[unlikely]] {
+            // both tours share their variables, so they must keep the same edges
+            keep(0, tours[1]);
+            keep(1, tours[0]);
+        }
+        this->price(edges, upper);
+        return edges;
+    }
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "finite.hpp"
+
+
+namespace utils {
+    enum class output_format {
+        /** Human readable report for single runs, tab separated rows for the grid. */
+        text,
+        /** Comma separated values, with a header line first. */
+        csv,
+        /** One JSON object per line. */
+        json,
+    };
+
+    [[gnu::cold]]
+    static output_format parse_output_format(const std::string& name) {
+        if (name == "text") {
+            return output_format::text;
+        } else if (name == "csv") {
+            return output_format::csv;
+        } else if (name == "json") {
+            return output_format::json;
+        }
+        throw std::invalid_argument("Unknown output format \"" + name + "\", expected text, csv or json.");
+    }
+
+    /**
+     * Machine readable summary of a single run, for either the model or the lagrangian relaxation.
+     *
+     * Measures that do not apply to the method, or that are unknown after a failure, are left empty
+     * and written as `null` in JSON and as an empty field in CSV, and so are infinite or NaN values,
+     * such as the bounds of a run stopped before finding any.
+     */
+    struct run_report final {
+        std::string_view method;
+        unsigned nodes = 0;
+        unsigned k = 0;
+        std::string status = "ok";
+
+        std::optional<double> lower = std::nullopt;
+        std::optional<double> upper = std::nullopt;
+        std::optional<double> root = std::nullopt;
+        std::optional<int64_t> search_nodes = std::nullopt;
+        std::optional<int64_t> iterations = std::nullopt;
+        std::optional<int64_t> callbacks = std::nullopt;
+        std::optional<int64_t> cuts = std::nullopt;
+        std::optional<double> build_time = std::nullopt;
+        std::optional<double> solve_time = std::nullopt;
+        std::optional<int64_t> tour_1 = std::nullopt;
+        std::optional<int64_t> tour_2 = std::nullopt;
+        std::optional<int64_t> similarity = std::nullopt;
+
+        /** Relative gap between the bounds, when both are known. */
+        [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+        inline std::optional<double> gap() const noexcept {
+            if (!this->lower || !this->upper || *this->upper == 0) [[unlikely]] {
+                return std::nullopt;
+            }
+            return (*this->upper - *this->lower) / *this->upper;
+        }
+
+        /** Calls `visit(name, value)` for every column, always in the same order. */
+        template <typename Visitor> [[gnu::cold]]
+        inline void columns(Visitor&& visit) const {
+            visit("method", this->method);
+            visit("nodes", this->nodes);
+            visit("k", this->k);
+            visit("status", std::string_view(this->status));
+            visit("lower", this->lower);
+            visit("upper", this->upper);
+            visit("gap", this->gap());
+            visit("root", this->root);
+            visit("search_nodes", this->search_nodes);
+            visit("iterations", this->iterations);
+            visit("callbacks", this->callbacks);
+            visit("cuts", this->cuts);
+            visit("build_time", this->build_time);
+            visit("solve_time", this->solve_time);
+            visit("tour_1", this->tour_1);
+            visit("tour_2", this->tour_2);
+            visit("similarity", this->similarity);
+        }
+
+    private:
+        /** Writes `value` as JSON when `sep` is zero, else as a field separated by `sep`. */
+        template <typename Value> [[gnu::cold]]
+        static inline void write(std::ostream& os, const Value& value, char sep) {
+            if constexpr (std::is_same_v<Value, std::string_view>) {
+                const bool json = sep == '\0';
+                const bool quoted = json || value.find_first_of(std::string { sep, '"', '\n' }) != value.npos;
+                if (!quoted) [[likely]] {
+                    os << value;
+                    return;
+                }
+
+                os << '"';
+                for (char chr : value) {
+                    if (chr == '"') {
+                        os << (json ? "\\\"" : "\"\"");
+                    } else if (json && chr == '\\') {
+                        os << "\\\\";
+                    } else if (static_cast<unsigned char>(chr) < 0x20) {
+                        os << ' ';
+                    } else {
+                        os << chr;
+                    }
+                }
+                os << '"';
+            } else if constexpr (std::is_floating_point_v<Value>) {
+                if (is_finite(value)) [[likely]] {
+                    os << value;
+                } else if (sep == '\0') {
+                    os << "null";
+                }
+            } else {
+                os << value;
+            }
+        }
+
+        template <typename Value> [[gnu::cold]]
+        static inline void write(std::ostream& os, const std::optional<Value>& value, char sep) {
+            if (value) [[likely]] {
+                write(os, *value, sep);
+            } else if (sep == '\0') {
+                os << "null";
+            }
+        }
+
+    public:
+        /** Column names separated by `sep`. */
+        [[gnu::cold]]
+        static std::string header(char sep) {
+            std::string line;
+            run_report().columns([&line, sep](std::string_view name, const auto&) {
+                if (!line.empty()) {
+                    line += sep;
+                }
+                line += name;
+            });
+            return line;
+        }
+
+        /** Values separated by `sep`, in the order of `header`. */
+        [[gnu::cold]]
+        void write_row(std::ostream& os, char sep) const {
+            const auto precision = os.precision(12);
+            bool first = true;
+            this->columns([&os, &first, sep](std::string_view, const auto& value) {
+                if (!first) {
+                    os << sep;
+                }
+                first = false;
+                write(os, value, sep);
+            });
+            os << '\n';
+            os.precision(precision);
+        }
+
+        [[gnu::cold]]
+        void write_json(std::ostream& os) const {
+            const auto precision = os.precision(12);
+            bool first = true;
+            os << '{';
+            this->columns([&os, &first](std::string_view name, const auto& value) {
+                os << (first ? "\"" : ",\"") << name << "\":";
+                first = false;
+                write(os, value, '\0');
+            });
+            os << "}\n";
+            os.precision(precision);
+        }
+    };
+}
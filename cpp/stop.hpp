@@ -0,0 +1,29 @@
+#pragma once
+
+#include <atomic>
+#include <csignal>
+
+
+namespace utils {
+    /** Raised by an interrupt to make every running solve stop and report what it has found. */
+    inline std::atomic<bool> stop_requested = false;
+
+    static_assert(std::atomic<bool>::is_always_lock_free, "stop flag must be safe to set from a signal handler");
+
+    [[gnu::cold]] [[gnu::nothrow]]
+    static void request_stop(int) noexcept {
+        stop_requested.store(true, std::memory_order_relaxed);
+    }
+
+    [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+    inline bool should_stop() noexcept {
+        return stop_requested.load(std::memory_order_relaxed);
+    }
+
+    /** Turns SIGINT and SIGTERM into a stop request, returning false if the handlers could not be set. */
+    [[gnu::cold]] [[gnu::nothrow]]
+    static bool stop_on_interrupt() noexcept {
+        return std::signal(SIGINT, request_stop) != SIG_ERR
+            && std::signal(SIGTERM, request_stop) != SIG_ERR;
+    }
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "finite.hpp"
+
+
+namespace utils {
+    /** A point of the solve progress, with times in seconds since the solver started. */
+    struct progress_event final {
+        enum class kind : uint8_t {
+            /** First relaxation solved at the root node. */
+            root,
+            /** Improved integral solution accepted by the subtour elimination. */
+            incumbent,
+            /** Periodic sample of the bounds. */
+            sample,
+        };
+
+        kind type;
+        /** Model the event came from, nonzero only when the tours are solved separately. */
+        uint8_t model;
+        double time;
+        double bound;
+        double incumbent;
+        double nodes;
+
+        [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+        inline std::string_view name() const noexcept {
+            switch (this->type) {
+                case kind::root:
+                    return "root";
+                case kind::incumbent:
+                    return "incumbent";
+                default:
+                    return "sample";
+            }
+        }
+
+        /** Whether an incumbent was known, since a missing one is stored as infinity. */
+        [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+        inline bool has_incumbent() const noexcept {
+            return is_finite(this->incumbent);
+        }
+
+        [[gnu::pure]] [[gnu::cold]] [[gnu::nothrow]]
+        inline double gap() const noexcept {
+            if (!this->has_incumbent() || this->incumbent == 0) [[unlikely]] {
+                return std::numeric_limits<double>::infinity();
+            }
+            return (this->incumbent - this->bound) / this->incumbent;
+        }
+    };
+
+    /** Root relaxation and the history of bounds and incumbents of one solve. */
+    struct timeline final {
+    private:
+        double interval;
+        double last_sample = -std::numeric_limits<double>::infinity();
+        double best = std::numeric_limits<double>::infinity();
+
+    public:
+        std::optional<double> root_lp = std::nullopt;
+        std::vector<progress_event> events;
+
+        /** Timeline keeping a bound sample at most every `interval` seconds. */
+        [[gnu::cold]]
+        explicit timeline(double interval = 1.0): interval(interval) { }
+
+        [[gnu::hot]]
+        inline void root(double time, double bound) {
+            if (!this->root_lp) [[unlikely]] {
+                this->root_lp = bound;
+                this->events.push_back({ progress_event::kind::root, 0, time, bound, this->best, 0 });
+            }
+        }
+
+        /** Records `objective` if it improves on the incumbent so far. */
+        [[gnu::hot]]
+        inline void incumbent(double time, double objective, double bound, double nodes) {
+            if (objective < this->best) {
+                this->best = objective;
+                this->events.push_back({ progress_event::kind::incumbent, 0, time, bound, objective, nodes });
+            }
+        }
+
+        /** Records a sample if the last one is older than the interval. */
+        [[gnu::hot]]
+        inline void sample(double time, double bound, double incumbent, double nodes) {
+            if (this->interval > 0 && time - this->last_sample >= this->interval) [[unlikely]] {
+                this->last_sample = time;
+                this->events.push_back({ progress_event::kind::sample, 0, time, bound, incumbent, nodes });
+            }
+        }
+
+        /** Merges the timeline of the model `model` solved alongside this one. */
+        [[gnu::cold]]
+        void merge(const timeline& other, uint8_t model) {
+            // the objective is the sum of both models, so the root is only known if both reached it
+            if (this->root_lp && other.root_lp) {
+                this->root_lp = *this->root_lp + *other.root_lp;
+            } else {
+                this->root_lp = std::nullopt;
+            }
+            for (auto event : other.events) {
+                event.model = model;
+                this->events.push_back(event);
+            }
+            std::stable_sort(this->events.begin(), this->events.end(), [](const auto& a, const auto& b) {
+                return a.time < b.time;
+            });
+        }
+
+        /** Writes the events as CSV, with a header line. */
+        [[gnu::cold]]
+        friend std::ostream& operator<<(std::ostream& os, const timeline& line) {
+            os << "model,time,event,bound,incumbent,gap,nodes\n";
+            for (const auto& event : line.events) {
+                os << unsigned(event.model) << ',' << event.time << ',' << event.name() << ',' << event.bound << ',';
+                if (event.has_incumbent()) [[likely]] {
+                    os << event.incumbent << ',' << event.gap();
+                } else {
+                    os << ',';
+                }
+                os << ',' << event.nodes << '\n';
+            }
+            return os;
+        }
+    };
+}
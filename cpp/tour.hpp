@@ -1,47 +1,48 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <concepts>
 #include <optional>
 #include <span>
 #include <vector>
 
-#include <gurobi_c++.h>
 #include "vertex.hpp"
+#include "costs.hpp"
 
 
 namespace utils {
-    template <typename Item>
-    struct matrix final {
+    /** Support graph of an integral solution, where every vertex has at most two neighbors. */
+    struct adjacency final {
     private:
-        Item *buffer;
-        size_t len;
+        std::vector<std::array<uint32_t, 2>> neighbors;
+        std::vector<uint8_t> degree;
 
     public:
-        inline matrix(size_t n): len(n) {
-            this->buffer = new Item[n * n];
-        }
-
-        inline ~matrix() {
-            delete[] this->buffer;
-        }
-
-        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
-        constexpr size_t size() const noexcept {
-            return this->len;
-        }
+        [[gnu::hot]]
+        explicit inline adjacency(size_t n): neighbors(n), degree(n, 0) { }
 
+        /** Number of vertices. */
         [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
-        constexpr size_t total() const noexcept {
-            return this->size() * this->size();
+        inline size_t size() const noexcept {
+            return this->degree.size();
         }
 
-        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
-        constexpr std::span<Item> operator[](std::size_t idx) noexcept {
-            return std::span<Item>(this->buffer + idx * this->size(), this->size());
+        /** Links `u` and `v`, ignoring edges past the second on either end. */
+        [[gnu::hot]] [[gnu::nothrow]]
+        inline void add(unsigned u, unsigned v) noexcept {
+            if (this->degree[u] >= 2 || this->degree[v] >= 2) [[unlikely]] {
+                return;
+            }
+            this->neighbors[u][this->degree[u]++] = v;
+            this->neighbors[v][this->degree[v]++] = u;
         }
 
         [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
-        constexpr std::span<const Item> operator[](std::size_t idx) const noexcept {
-            return std::span<const Item>(this->buffer + idx * this->size(), this->size());
+        inline std::span<const uint32_t> operator[](unsigned u) const noexcept {
+            return std::span<const uint32_t>(this->neighbors[u].data(), this->degree[u]);
         }
     };
 }
@@ -51,28 +52,42 @@ struct tour final : public std::vector<unsigned> {
 private:
     struct iter_tours final {
     public:
-        inline iter_tours(
-            std::span<const vertex> vertices,
-            const  utils::matrix<bool>& solution
-        ) noexcept:
-            seen(vertices.size(), false), vertices(vertices), solution(solution)
+        explicit inline iter_tours(const utils::adjacency& solution) noexcept:
+            seen((solution.size() + 63) / 64, 0), solution(solution)
         { }
 
     private:
-        std::vector<bool> seen;
-        std::span<const vertex> vertices;
-        const  utils::matrix<bool>& solution;
+        /** Bitset of visited vertices. */
+        std::vector<uint64_t> seen;
+        const utils::adjacency& solution;
+        /** Every word of `seen` before this one is full. */
+        size_t cursor = 0;
 
         [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
         inline size_t count() const noexcept {
-            return this->vertices.size();
+            return this->solution.size();
         }
 
         [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
-        inline std::optional<unsigned> new_node() const noexcept {
-            for (unsigned node = 0; node < this->count(); node++) {
-                if (!this->seen[node]) [[likely]] {
-                    return node;
+        inline bool is_seen(unsigned node) const noexcept {
+            return (this->seen[node / 64] >> (node % 64)) & 1;
+        }
+
+        [[gnu::hot]] [[gnu::nothrow]]
+        inline void mark(unsigned node) noexcept {
+            this->seen[node / 64] |= uint64_t(1) << (node % 64);
+        }
+
+        [[gnu::hot]] [[gnu::nothrow]]
+        inline std::optional<unsigned> new_node() noexcept {
+            for (; this->cursor < this->seen.size(); this->cursor++) {
+                const uint64_t free = ~this->seen[this->cursor];
+                if (free != 0) [[likely]] {
+                    const size_t node = this->cursor * 64 + std::countr_zero(free);
+                    if (node < this->count()) [[likely]] {
+                        return node;
+                    }
+                    return std::nullopt;
                 }
             }
             return std::nullopt;
@@ -80,9 +95,8 @@ private:
 
         [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
         inline std::optional<unsigned> best_next(unsigned u) const noexcept {
-            auto solution = this->solution[u];
-            for (unsigned v = 0; v < this->count(); v++) {
-                if (solution[v] && !this->seen[v]) [[likely]] {
+            for (unsigned v : this->solution[u]) {
+                if (!this->is_seen(v)) [[likely]] {
                     return v;
                 }
             }
@@ -92,10 +106,9 @@ private:
         [[gnu::hot]]
         inline tour next_tour(unsigned node) noexcept {
             auto vertices = tour();
-            vertices.reserve(this->count());
 
             for (unsigned len = this->count(); len > 0; len--) {
-                this->seen[node] = true;
+                this->mark(node);
                 vertices.push_back(node);
 
                 if (auto next = this->best_next(node)) [[likely]] {
@@ -119,12 +132,8 @@ private:
 
 public:
     [[gnu::hot]] [[gnu::nothrow]]
-    static tour min_sub_tour(
-        std::span<const vertex> vertices,
-        const  utils::matrix<bool>& solution
-    ) noexcept
-    {
-        iter_tours tours(vertices, solution);
+    static tour min_sub_tour(const utils::adjacency& solution) noexcept {
+        iter_tours tours(solution);
 
         auto min_tour = tour();
         if (auto first = tours.next_tour()) {
@@ -141,12 +150,53 @@ public:
         return min_tour;
     }
 
+    /** Every connected component of the solution, from smallest to largest, in O(n). */
+    [[gnu::hot]]
+    static std::vector<tour> sub_tours(const utils::adjacency& solution) {
+        iter_tours tours(solution);
+
+        auto all = std::vector<tour>();
+        while (auto tour = tours.next_tour()) [[likely]] {
+            all.push_back(std::move(*tour));
+        }
+
+        std::stable_sort(all.begin(), all.end(), [](const auto& a, const auto& b) {
+            return a.size() < b.size();
+        });
+        return all;
+    }
+
+    /** Greedy tour that always moves to the cheapest unvisited vertex. */
+    [[gnu::hot]]
+    static tour nearest_neighbour(size_t order, std::invocable<unsigned, unsigned> auto&& cost, unsigned start = 0) {
+        auto seen = std::vector<bool>(order, false);
+        auto path = tour();
+        path.reserve(order);
+
+        for (unsigned u = start; path.size() < order; ) {
+            seen[u] = true;
+            path.push_back(u);
+
+            std::optional<unsigned> best = std::nullopt;
+            for (unsigned v = 0; v < order; v++) {
+                if (!seen[v] && (!best || cost(u, v) < cost(u, *best))) {
+                    best = v;
+                }
+            }
+            if (!best) [[unlikely]] {
+                break;
+            }
+            u = *best;
+        }
+        return path;
+    }
+
     [[gnu::pure]] [[gnu::nothrow]]
-    static double cost(uint8_t i, const std::vector<vertex>& tour) noexcept {
-        double total_cost = 0.0;
+    static int64_t cost(const costs& costs, uint8_t i, const tour& tour) noexcept {
+        int64_t total_cost = 0;
         for (unsigned v = 0; v < tour.size(); v++) {
             const unsigned next = (v + 1) % tour.size();
-            total_cost += tour[v][i].cost(tour[next][i]);
+            total_cost += costs(i, tour[v], tour[next]);
         }
         return total_cost;
     }
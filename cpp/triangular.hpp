@@ -0,0 +1,198 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+
+namespace utils {
+    /** Position of edge `(u, v)` in a packed strictly lower triangular matrix. */
+    [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+    constexpr size_t triangular_index(unsigned u, unsigned v) noexcept {
+        if (u > v) {
+            std::swap(u, v);
+        }
+        return (size_t(v) * (v - 1)) / 2 + u;
+    }
+
+    /** Inverse of `triangular_index`, with `u < v`. */
+    [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+    inline std::pair<unsigned, unsigned> triangular_edge(size_t index) noexcept {
+        auto v = static_cast<unsigned>((1.0 + std::sqrt(1.0 + 8.0 * double(index))) / 2.0);
+        while ((size_t(v) * (v - 1)) / 2 > index) {
+            v -= 1;
+        }
+        while ((size_t(v + 1) * v) / 2 <= index) {
+            v += 1;
+        }
+        return { static_cast<unsigned>(index - (size_t(v) * (v - 1)) / 2), v };
+    }
+
+    /** Number of edges in a complete graph of order `n`. */
+    [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+    constexpr size_t triangular_size(size_t n) noexcept {
+        return (n * (n - 1)) / 2;
+    }
+
+    /** Allocator returning storage aligned to `Alignment` bytes, e.g. for cache lines or SIMD loads. */
+    template <typename Item, size_t Alignment = 64>
+    struct aligned_allocator {
+        static_assert(std::has_single_bit(Alignment), "'Alignment' must be a power of two.");
+        using value_type = Item;
+
+        template <typename Other>
+        struct rebind {
+            using other = aligned_allocator<Other, Alignment>;
+        };
+
+        constexpr aligned_allocator() noexcept = default;
+
+        template <typename Other>
+        constexpr aligned_allocator(const aligned_allocator<Other, Alignment>&) noexcept { }
+
+        [[gnu::cold]] [[nodiscard]]
+        inline Item *allocate(size_t n) {
+            return static_cast<Item *>(::operator new(n * sizeof(Item), std::align_val_t(Alignment)));
+        }
+
+        [[gnu::cold]]
+        inline void deallocate(Item *ptr, size_t) noexcept {
+            ::operator delete(ptr, std::align_val_t(Alignment));
+        }
+
+        template <typename Other>
+        constexpr bool operator==(const aligned_allocator<Other, Alignment>&) const noexcept {
+            return true;
+        }
+    };
+
+    /**
+     * Symmetric matrix without diagonal, packed in `triangular_index` order.
+     *
+     * Stores half the cells of a dense `n * n` matrix and, being backed by a vector, is safely
+     * copyable and movable. The layout is prefix-stable, so the cells of the first `m < n`
+     * vertices are the first `triangular_size(m)` items.
+     */
+    template <typename Item, typename Allocator = std::allocator<Item>>
+    struct triangular final {
+    private:
+        std::vector<Item, Allocator> buffer;
+        size_t len;
+
+    public:
+        [[gnu::cold]]
+        explicit inline triangular(size_t n, const Item& value = Item()):
+            buffer(triangular_size(n), value), len(n)
+        { }
+
+        /** Takes ownership of cells already in `triangular_index` order. */
+        [[gnu::cold]]
+        explicit inline triangular(size_t n, std::vector<Item, Allocator>&& cells):
+            buffer(std::move(cells)), len(n)
+        {
+            this->buffer.resize(triangular_size(n));
+        }
+
+        /** Number of rows and columns. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        constexpr size_t size() const noexcept {
+            return this->len;
+        }
+
+        /** Number of stored cells. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        constexpr size_t total() const noexcept {
+            return this->buffer.size();
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline Item& operator()(unsigned u, unsigned v) noexcept {
+            return this->buffer[triangular_index(u, v)];
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline const Item& operator()(unsigned u, unsigned v) const noexcept {
+            return this->buffer[triangular_index(u, v)];
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline Item& operator[](size_t index) noexcept {
+            return this->buffer[index];
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline const Item& operator[](size_t index) const noexcept {
+            return this->buffer[index];
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline const Item *data() const noexcept {
+            return this->buffer.data();
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline auto begin() const noexcept {
+            return this->buffer.begin();
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline auto end() const noexcept {
+            return this->buffer.end();
+        }
+    };
+
+    /** Bitset specialization, one bit per edge. */
+    template <>
+    struct triangular<bool> final {
+    private:
+        std::vector<uint64_t> words;
+        size_t len;
+
+        [[gnu::const]] [[gnu::hot]] [[gnu::nothrow]]
+        static constexpr uint64_t bit(size_t index) noexcept {
+            return uint64_t(1) << (index % 64);
+        }
+
+    public:
+        [[gnu::cold]]
+        explicit inline triangular(size_t n, bool value = false):
+            words((triangular_size(n) + 63) / 64, value ? ~uint64_t(0) : 0), len(n)
+        { }
+
+        /** Number of rows and columns. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        constexpr size_t size() const noexcept {
+            return this->len;
+        }
+
+        /** Number of stored cells. */
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        constexpr size_t total() const noexcept {
+            return triangular_size(this->size());
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline bool operator[](size_t index) const noexcept {
+            return this->words[index / 64] & bit(index);
+        }
+
+        [[gnu::pure]] [[gnu::hot]] [[gnu::nothrow]]
+        inline bool operator()(unsigned u, unsigned v) const noexcept {
+            return (*this)[triangular_index(u, v)];
+        }
+
+        [[gnu::hot]] [[gnu::nothrow]]
+        inline void set(unsigned u, unsigned v, bool value = true) noexcept {
+            const size_t index = triangular_index(u, v);
+            if (value) {
+                this->words[index / 64] |= bit(index);
+            } else {
+                this->words[index / 64] &= ~bit(index);
+            }
+        }
+    };
+}
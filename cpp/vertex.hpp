@@ -54,6 +54,11 @@ namespace utils {
         static not_enough_items in(std::array<Item, N> current, size_t expected) {
             return not_enough_items(typeid(Item).name(), current.size(), expected);
         }
+
+        template <typename Item> [[gnu::cold]]
+        static not_enough_items in(const std::vector<Item>& current, size_t expected) {
+            return not_enough_items(typeid(Item).name(), current.size(), expected);
+        }
     };
 
     template <typename Item>